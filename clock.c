@@ -12,6 +12,7 @@
 #include <avr/io.h>
 #include "clock.h"
 
+#if !KBD_CRITICAL_STATS
 /* wait time * 320 us */
 void clockWait(uint8_t time) {
 
@@ -22,3 +23,33 @@ void clockWait(uint8_t time) {
 		}
 	}
 }
+#endif
+
+static uint16_t lastTicks;
+static uint16_t millis;
+
+/* the remainder stays in lastTicks, so no time is lost between calls */
+void clockPoll(void) {
+	uint16_t now = clockTicks();
+	uint16_t count = millis;
+	uint8_t sreg;
+
+	while ((uint16_t) (now - lastTicks) >= CLOCK_T1_1ms) {
+		lastTicks += CLOCK_T1_1ms;
+		count++;
+	}
+	if (count == millis)
+		return;
+	/* the interrupts read it for the trace, both bytes have to change at once */
+	sreg = SREG;
+	cli();
+	criticalStart();
+	millis = count;
+	criticalStop();
+	SREG = sreg;
+	criticalEnd(CRITICAL_CLOCK_MILLIS);
+}
+
+uint16_t clockMillis(void) {
+	return millis;
+}
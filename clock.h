@@ -11,6 +11,11 @@
 #ifndef __clock_h_included__
 #define	__clock_h_included__
 
+#include <inttypes.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "critical.h"
+
 /* #define F_CPU           12000000L   12MHz  already defined in usbdrv*/
 #define TIMERVALUE      TCNT0
 #define CLOCK_T_320us	60
@@ -19,10 +24,60 @@
 #define TCCR0B  TCCR0
 #endif
 
-/* set prescaler to 64 */
-#define clockInit()  TCCR0B = (1 << CS01) | (1 << CS00);
+/* timer 1 runs free at F_CPU / 8 = 1.5 MHz, 0.667 us per tick */
+#define TIMER1VALUE     TCNT1
+#define CLOCK_T1_1ms	1500
+
+#if KBD_CRITICAL_STATS
+/* timer 0 counts CPU cycles for critical.h, too fast for clockWait() */
+#define clockInit()  TCCR0B = (1 << CS00); TCCR1B = (1 << CS11);
+#else
+/* set prescaler to 64 on timer 0 and to 8 on timer 1 */
+#define clockInit()  TCCR0B = (1 << CS01) | (1 << CS00); TCCR1B = (1 << CS11);
 
 /* wait time * 320 us */
 void clockWait(uint8_t time);
+#endif
+
+/* count whole milliseconds from timer 1, call at least every 40 ms */
+void clockPoll(void);
+uint16_t clockMillis(void);
+
+/* the 16 bit timer 1 registers share one temporary byte, an interrupt that
+ * touches timer 1 between the two halves of an access corrupts it */
+static inline uint16_t clockTicks(void) {
+	uint8_t sreg = SREG;
+	uint16_t ticks;
+
+	cli();
+	criticalStart();
+	ticks = TIMER1VALUE;
+	criticalStop();
+	SREG = sreg;
+	criticalEnd(CRITICAL_CLOCK_TICKS);
+	return ticks;
+}
+
+static inline void clockSetCompareA(uint16_t ticks) {
+	uint8_t sreg = SREG;
+
+	cli();
+	criticalStart();
+	OCR1A = ticks;
+	criticalStop();
+	SREG = sreg;
+	criticalEnd(CRITICAL_COMPARE_A);
+}
+
+static inline void clockSetCompareB(uint16_t ticks) {
+	uint8_t sreg = SREG;
+
+	cli();
+	criticalStart();
+	OCR1B = ticks;
+	criticalStop();
+	SREG = sreg;
+	criticalEnd(CRITICAL_COMPARE_B);
+}
 
 #endif /* __clock_h_included__ */
@@ -0,0 +1,36 @@
+/*
+ * critical.c - part of USBaspSunType5c
+ *
+ * Description....: Optional timing of the regions run with interrupts off
+ * Licence........: GNU GPL v3 (see LICENSE)
+ *
+ * V-USB needs INT0 served within a few cycles, every region with interrupts
+ * off delays it. Each call site gets its longest region, the number of
+ * regions and their sum, so the host can work out the mean. Recording
+ * happens after interrupts are back on, to keep it out of the regions. An
+ * interrupt recording in between, like the receiver setting its compare
+ * value, may then lose a sample or tear the sum; fine for statistics.
+ */
+
+#include <inttypes.h>
+#include <string.h>
+#include <avr/interrupt.h>
+#include "critical.h"
+
+#if KBD_CRITICAL_STATS
+criticalStats_t criticalStats;
+volatile uint8_t criticalPaused;
+
+void criticalRecord(uint8_t site, uint8_t cycles) {
+	// only the main loop pauses, so no interrupt is halfway through here then
+	if (criticalPaused)
+		return;
+	if (cycles > criticalStats.max[site])
+		criticalStats.max[site] = cycles;
+	// stop before the mean goes wrong, the maximum is the number that matters
+	if (criticalStats.count[site] != 0xffff) {
+		criticalStats.count[site]++;
+		criticalStats.sum[site] += cycles;
+	}
+}
+#endif
@@ -0,0 +1,44 @@
+/*
+ * critical.h - part of USBaspSunType5c
+ *
+ * Description....: Optional timing of the regions run with interrupts off
+ * Licence........: GNU GPL v3 (see LICENSE)
+ */
+
+#ifndef __critical_h_included__
+#define __critical_h_included__
+
+#include <stdint.h>
+#include <avr/io.h>
+#include "diagProtocol.h"
+
+/* Set KBD_CRITICAL_STATS to 1 (e.g. -DKBD_CRITICAL_STATS=1 in the
+ * Makefile's CFLAGS) to time every cli() region below in CPU cycles.
+ * Timer 0 then runs at the CPU clock, see clockInit(), and clockWait() is
+ * gone. A region must stay below 256 cycles, a longer one shows up modulo
+ * 256. Costs two reads of TCNT0 in each region, so it is off by default. */
+#ifndef KBD_CRITICAL_STATS
+#define KBD_CRITICAL_STATS  0
+#endif
+
+#if KBD_CRITICAL_STATS
+extern criticalStats_t criticalStats;
+/* set while the main loop copies or clears criticalStats with interrupts
+ * on, criticalRecord() drops the samples that come in meanwhile */
+extern volatile uint8_t criticalPaused;
+
+void criticalRecord(uint8_t site, uint8_t cycles);
+
+/* criticalStart() right after cli(), criticalStop() right before SREG is
+ * restored and criticalEnd() after that, so recording runs with interrupts
+ * back on and does not count itself */
+#define criticalStart()     uint8_t criticalCycles = TCNT0
+#define criticalStop()      criticalCycles = TCNT0 - criticalCycles
+#define criticalEnd(site)   criticalRecord((site), criticalCycles)
+#else
+#define criticalStart()
+#define criticalStop()
+#define criticalEnd(site)
+#endif
+
+#endif /* __critical_h_included__ */
@@ -0,0 +1,195 @@
+/*
+ * diag.c - part of USBaspSunType5c
+ *
+ * Description....: Counters, configuration and a trace over vendor requests
+ * Licence........: GNU GPL v3 (see LICENSE)
+ *
+ * Nothing here needs a logic analyzer on PC2: the host reads the blocks of
+ * diagProtocol.h through control transfers, see tools/sundiag.c. Every
+ * block is copied when the request comes in and read in one transfer, so
+ * the packets of a read all come from one snapshot even though the main
+ * loop and the interrupts go on in between. usbFunctionRead() then hands
+ * the block out 8 bytes at a time. The trace ring itself lives in trace.c
+ * and reads back empty when tracing is compiled out.
+ */
+
+#include <inttypes.h>
+#include <string.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include "clock.h"
+#include "sunRx.h"
+#include "sunProtocol.h"
+#include "keymap.h"
+#include "keyState.h"
+#include "layer.h"
+#include "reportQueue.h"
+#include "hidDescriptor.h"
+#include "latency.h"
+#include "critical.h"
+#include "profile.h"
+#include "trace.h"
+#include "diag.h"
+
+static union {
+	diagCounters_t counters;
+	diagConfig_t config;
+	latencyStats_t latency;
+#if KBD_TRACE_LEVEL
+	diagTraceEntry_t trace[DIAG_TRACE_SIZE];
+#endif
+#if KBD_CRITICAL_STATS
+	criticalStats_t critical;
+#endif
+#if KBD_LOOP_PROFILE
+	loopStats_t loop;
+#endif
+} snapshot;
+static uint8_t readOffset;
+static uint8_t readLeft;
+
+static void takeCounters(void) {
+	uint8_t sreg = SREG;
+
+	snapshot.counters.version = DIAG_VERSION;
+	cli();
+	criticalStart();
+	snapshot.counters.rxOverflows = sunRxOverflows;
+	snapshot.counters.rxFramingErrors = sunRxFramingErrors;
+	snapshot.counters.rxMaxLateness = sunRxMaxLateness;
+	criticalStop();
+	SREG = sreg;
+	criticalEnd(CRITICAL_DIAG);
+	snapshot.counters.keyboardErrors = sunKeyboardErrors;
+	snapshot.counters.reportOverflows = reportQueueOverflows;
+	snapshot.counters.rollovers = keyStateRollovers;
+	snapshot.counters.millis = clockMillis();
+}
+
+#if KBD_TRACE_LEVEL
+/* oldest entry first, the interrupts trace too, so one entry at a time */
+static void takeTrace(void) {
+	uint8_t start = traceHead;
+	uint8_t sreg, i;
+
+	for (i = 0; i < DIAG_TRACE_SIZE; i++) {
+		sreg = SREG;
+		cli();
+		criticalStart();
+		snapshot.trace[i] = traceRing[(start + i) & TRACE_MASK];
+		criticalStop();
+		SREG = sreg;
+		criticalEnd(CRITICAL_DIAG);
+	}
+}
+#endif
+
+static void clearCounters(void) {
+	uint8_t sreg = SREG;
+
+	cli();
+	criticalStart();
+	sunRxOverflows = 0;
+	sunRxFramingErrors = 0;
+	sunRxMaxLateness = 0;
+	criticalStop();
+	SREG = sreg;
+	criticalEnd(CRITICAL_DIAG);
+#if KBD_CRITICAL_STATS
+	// far too long for a cli() region, V-USB allows 25 cycles
+	criticalPaused = 1;
+	memset(&criticalStats, 0, sizeof(criticalStats));
+	criticalPaused = 0;
+#endif
+	sunKeyboardErrors = 0;
+	reportQueueOverflows = 0;
+	keyStateRollovers = 0;
+#if KBD_TRACE_LEVEL
+	memset(traceRing, 0, sizeof(traceRing));
+#endif
+	latencyClear();
+#if KBD_LOOP_PROFILE
+	memset(&loopStats, 0, sizeof(loopStats));
+#endif
+}
+
+/* the vendor requests of usbFunctionSetup(), protocol and idle rate live there */
+usbMsgLen_t diagSetup(usbRequest_t *rq, uint8_t protocol, uint8_t idleRate) {
+	uint8_t size;
+
+	switch (rq->bRequest) {
+	case DIAG_RQ_COUNTERS:
+		takeCounters();
+		size = sizeof(snapshot.counters);
+		break;
+	case DIAG_RQ_CONFIG:
+		snapshot.config.version = DIAG_VERSION;
+		snapshot.config.hidLayout = hidLayout;
+		snapshot.config.protocol = protocol;
+		snapshot.config.idleRate = idleRate;
+		snapshot.config.sunLayout = sunLayout;
+		snapshot.config.keymapEepromValid = keymapEepromValid;
+		snapshot.config.layerMask = layerMask;
+		snapshot.config.reserved = 0;
+		snapshot.config.acKeys = KBD_AC_KEYS;
+		size = sizeof(snapshot.config);
+		break;
+	case DIAG_RQ_TRACE:
+#if KBD_TRACE_LEVEL
+		takeTrace();
+		size = sizeof(snapshot.trace);
+#else
+		size = 0;
+#endif
+		break;
+	case DIAG_RQ_LATENCY:
+		// only the main loop writes it, and that is where this runs
+		memcpy(&snapshot.latency, &latencyStats, sizeof(latencyStats));
+		size = sizeof(snapshot.latency);
+		break;
+	case DIAG_RQ_CRITICAL:
+#if KBD_CRITICAL_STATS
+		// interrupts update it too, they leave it alone while it is copied
+		criticalPaused = 1;
+		memcpy(&snapshot.critical, &criticalStats, sizeof(criticalStats));
+		criticalPaused = 0;
+		size = sizeof(snapshot.critical);
+#else
+		size = 0;
+#endif
+		break;
+	case DIAG_RQ_LOOP:
+#if KBD_LOOP_PROFILE
+		memcpy(&snapshot.loop, &loopStats, sizeof(loopStats));
+		size = sizeof(snapshot.loop);
+#else
+		size = 0;
+#endif
+		break;
+	case DIAG_RQ_CLEAR:
+		clearCounters();
+		return 0;
+	case DIAG_RQ_SET_LAYOUT:
+		if (rq->wValue.bytes[0] < HID_LAYOUTS)
+			eeprom_update_byte(&hidLayoutSetting, rq->wValue.bytes[0]);
+		return 0;
+	default:
+		return 0;
+	}
+
+	readOffset = 0;
+	readLeft = size;
+	if (rq->wLength.word < readLeft)
+		readLeft = rq->wLength.word;
+	return USB_NO_MSG;
+}
+
+/* called through usbFunctionRead(), a short chunk ends the transfer */
+uint8_t diagRead(uint8_t *data, uint8_t len) {
+	if (len > readLeft)
+		len = readLeft;
+	memcpy(data, (uint8_t *) &snapshot + readOffset, len);
+	readOffset += len;
+	readLeft -= len;
+	return len;
+}
@@ -0,0 +1,18 @@
+/*
+ * diag.h - part of USBaspSunType5c
+ *
+ * Description....: Counters, configuration and a trace over vendor requests
+ * Licence........: GNU GPL v3 (see LICENSE)
+ */
+
+#ifndef __diag_h_included__
+#define __diag_h_included__
+
+#include <stdint.h>
+#include "usbdrv.h"
+#include "diagProtocol.h"
+
+usbMsgLen_t diagSetup(usbRequest_t *rq, uint8_t protocol, uint8_t idleRate);
+uint8_t diagRead(uint8_t *data, uint8_t len);
+
+#endif /* __diag_h_included__ */
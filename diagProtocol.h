@@ -0,0 +1,130 @@
+/*
+ * diagProtocol.h - part of USBaspSunType5c
+ *
+ * Description....: Vendor requests of the diagnostics interface
+ * Licence........: GNU GPL v3 (see LICENSE)
+ *
+ * Shared by the firmware and tools/sundiag.c, so nothing AVR specific in
+ * here. All blocks are little endian and packed, which is what avr-gcc lays
+ * out anyway. A block is read in one control transfer with wLength set to
+ * its size, the firmware copies it when the request comes in. usbFunctionRead()
+ * limits a transfer to 254 bytes, which every block stays well below.
+ */
+
+#ifndef __diagprotocol_h_included__
+#define __diagprotocol_h_included__
+
+#include <stdint.h>
+
+/* bRequest of the vendor requests, wValue as noted */
+#define DIAG_RQ_COUNTERS    1   /* read diagCounters_t */
+#define DIAG_RQ_CONFIG      2   /* read diagConfig_t */
+#define DIAG_RQ_TRACE       3   /* read the trace, oldest entry first, empty without one */
+#define DIAG_RQ_CLEAR       4   /* zero the counters, the trace and all statistics */
+#define DIAG_RQ_SET_LAYOUT  5   /* store wValue as the report layout, used after replugging */
+#define DIAG_RQ_LATENCY     6   /* read latencyStats_t */
+#define DIAG_RQ_CRITICAL    7   /* read criticalStats_t, empty without KBD_CRITICAL_STATS */
+#define DIAG_RQ_LOOP        8   /* read loopStats_t, empty without KBD_LOOP_PROFILE */
+
+/* changes whenever one of the blocks below does. Only the counters and
+ * config blocks carry it, so sundiag reads the config block first before
+ * it decodes any of the others. */
+#define DIAG_VERSION        9
+
+typedef struct {
+	uint8_t version;
+	uint8_t rxOverflows;        /* sunRxOverflows */
+	uint8_t rxFramingErrors;    /* sunRxFramingErrors */
+	uint8_t keyboardErrors;     /* sunKeyboardErrors */
+	uint8_t reportOverflows;    /* reportQueueOverflows */
+	uint8_t rollovers;          /* keyStateRollovers */
+	uint16_t rxMaxLateness;     /* sunRxMaxLateness, timer 1 ticks of 2/3 us */
+	uint16_t millis;            /* clockMillis() when the block was taken */
+} __attribute__((packed)) diagCounters_t;
+
+typedef struct {
+	uint8_t version;
+	uint8_t hidLayout;          /* HID_LAYOUT_* in use */
+	uint8_t protocol;           /* 0 boot, 1 report */
+	uint8_t idleRate;           /* in 4 ms units */
+	uint8_t sunLayout;          /* layout byte of the keyboard */
+	uint8_t keymapEepromValid;  /* 1 if the EEPROM remapping is used */
+	uint8_t layerMask;          /* keymap layers on right now */
+	uint8_t reserved;
+	uint16_t acKeys;            /* KBD_AC_KEYS */
+} __attribute__((packed)) diagConfig_t;
+
+/* what a trace entry records */
+#define DIAG_TRACE_NONE     0   /* unused entry */
+#define DIAG_TRACE_KEYBOARD 1   /* data: byte from the keyboard */
+#define DIAG_TRACE_USB_RESET 2  /* host reset the bus */
+#define DIAG_TRACE_PROTOCOL 3   /* data: protocol the host asked for */
+#define DIAG_TRACE_UNMAPPED 4   /* data: scancode without a keymap entry */
+#define DIAG_TRACE_FRAMING  5   /* data: byte received without a stop bit */
+#define DIAG_TRACE_GLITCH   6   /* start bit gone at its middle */
+#define DIAG_TRACE_COMMAND  7   /* data: byte sent to the keyboard */
+#define DIAG_TRACE_BAD_ID   8   /* data: keyboard ID that is not a Type 5 */
+#define DIAG_TRACE_EVENTS   9
+
+typedef struct {
+	uint16_t millis;
+	uint8_t event;
+	uint8_t data;
+} __attribute__((packed)) diagTraceEntry_t;
+
+/* entries kept by trace.c, must be a power of two */
+#define DIAG_TRACE_SIZE     16
+
+/* latency of a key from its start bit on the keyboard line until ... */
+#define LATENCY_DECODED     0   /* the stop bit was sampled */
+#define LATENCY_BUILT       1   /* the report was queued */
+#define LATENCY_TAKEN       2   /* the host fetched the report */
+#define LATENCY_STAGES      3
+
+/* upper bounds of the buckets in ms, each passed through unit(), the last
+ * bucket has none. A byte alone takes 7.9 ms on the line, the host polls
+ * every 10 ms and takes an NKRO report in four polls. */
+#define LATENCY_BOUNDS(unit) unit(8), unit(10), unit(12), unit(16), unit(24), unit(36), unit(48)
+#define LATENCY_BUCKETS     8
+
+typedef struct {
+	uint16_t count[LATENCY_STAGES][LATENCY_BUCKETS];
+	uint32_t max[LATENCY_STAGES];   /* timer 1 ticks of 2/3 us */
+} __attribute__((packed)) latencyStats_t;
+
+/* the places that turn interrupts off, see critical.h */
+#define CRITICAL_CLOCK_TICKS    0   /* clockTicks() */
+#define CRITICAL_COMPARE_A      1   /* clockSetCompareA() */
+#define CRITICAL_COMPARE_B      2   /* clockSetCompareB() */
+#define CRITICAL_TX_KICK        3   /* queueing a keyboard command */
+#define CRITICAL_DIAG           4   /* taking or clearing the counters */
+#define CRITICAL_CLOCK_MILLIS   5   /* clockPoll() counting a millisecond */
+#define CRITICAL_SITES          6
+
+typedef struct {
+	uint16_t max[CRITICAL_SITES];   /* CPU cycles of 1/12 us */
+	uint16_t count[CRITICAL_SITES]; /* stops at 65535 */
+	uint32_t sum[CRITICAL_SITES];
+} __attribute__((packed)) criticalStats_t;
+
+/* the stages of the main loop, see profile.h */
+#define LOOP_USB            0   /* usbPoll() */
+#define LOOP_HOUSEKEEPING   1   /* clock, keyboard handshake and tap-hold timers */
+#define LOOP_KEYBOARD       2   /* draining and parsing the keyboard bytes */
+#define LOOP_REPORT         3   /* handing reports to the interrupt endpoint */
+#define LOOP_STAGES         4
+
+/* upper bounds of the iteration time buckets in us, each passed through
+ * unit(), the last bucket has none */
+#define LOOP_BOUNDS(unit)   unit(100), unit(500), unit(1000), unit(5000), unit(10000), unit(25000), unit(50000)
+#define LOOP_BUCKETS        8
+
+typedef struct {
+	uint32_t iterations;
+	uint32_t maxIteration;          /* timer 1 ticks of 2/3 us */
+	uint32_t stageSum[LOOP_STAGES];
+	uint16_t stageMax[LOOP_STAGES];
+	uint16_t buckets[LOOP_BUCKETS]; /* stop at 65535 */
+} __attribute__((packed)) loopStats_t;
+
+#endif /* __diagprotocol_h_included__ */
@@ -3,35 +3,18 @@
 
 #define ledRedOn()	 		PORTC &= ~(1 << PC1)
 #define ledRedOff()			PORTC |= (1 << PC1)
-#define debugtx_hi()		PORTC |= (1 << PC2)
-#define debugtx_low()		PORTC &= ~(1 << PC2)
-#define tx_low()				PORTB &= ~(1 << PB3)
-#define tx_hi()	  			PORTB |= (1 << PB3)
 #define ledGreenOn()  	PORTC &= ~(1 << PC0)
 #define ledGreenOff() 	PORTC |= (1 << PC0)
-#define bellOn()				sendToKeyboard(0x02, 1)
-#define bellOff()	  		sendToKeyboard(0x03, 1)
-#define clickOn() 			soundIsOn = 1;sendToKeyboard(0x0a, 1)
-#define clickOff()    	soundIsOn = 0;sendToKeyboard(0x0b, 1)
-#define updateLeds()  	sendToKeyboard(0x0e, 1);sendToKeyboard(leds, 1)
-#define resetKbrd()	  sendToKeyboard(0x01)
-#define getLayout()	  sendToKeyboard(0x0F)
-
-// due to the 12MHz crystal a clk is 83.33ns
-#define DELAY_1_CLK asm volatile("nop")
-// 5 are 416.7 ns
-#define DELAY_5_CLK DELAY_1_CLK;DELAY_1_CLK;DELAY_1_CLK;DELAY_1_CLK;DELAY_1_CLK
-// 10 are 833.33 ns
-#define DELAY_10_CLK DELAY_5_CLK;DELAY_5_CLK
-
-#define DELAY_HALF_KB_CLK() _delay_us(417)
-#define DELAY_FULL_KB_CLK() _delay_us(833)
-
+// these only queue the command, see sunTx.c
+#define bellOn()				sunTxCommand(SUNTX_SLOT_BELL, SUN_CMD_BELL_ON)
+#define bellOff()	  		sunTxCommand(SUNTX_SLOT_BELL, SUN_CMD_BELL_OFF)
+#define clickOn() 			soundIsOn = 1;sunTxCommand(SUNTX_SLOT_CLICK, SUN_CMD_CLICK_ON)
+#define clickOff()    	soundIsOn = 0;sunTxCommand(SUNTX_SLOT_CLICK, SUN_CMD_CLICK_OFF)
+#define updateLeds()  	sunTxLeds(leds)
+#define resetKbrd()	  sunTxCommand(SUNTX_SLOT_RESET, SUN_CMD_RESET)
+#define getLayout()	  sunTxCommand(SUNTX_SLOT_LAYOUT, SUN_CMD_LAYOUT)
 
 void toggleSound();
-void wiggle(uchar times);
-void displayValue32(uint32_t toDisplay);
-void displayValue8(uint8_t toDisplay);
 
 #include "helperFunctions.c" 
 
@@ -0,0 +1,225 @@
+/*
+ * hidDescriptor.c - part of USBaspSunType5c
+ *
+ * Description....: Report descriptor layouts, picked at start from EEPROM
+ * Licence........: GNU GPL v3 (see LICENSE)
+ *
+ * All layouts are in flash and handed out by usbFunctionDescriptor(). The
+ * configuration descriptor carries the length of the report descriptor, so
+ * it is copied to RAM once and patched, every length comes from sizeof().
+ * Write 0, 1 or 2 to hidLayoutSetting (make eeprom) to switch layouts,
+ * anything else means the KBD_LAYOUT default.
+ */
+
+#include <inttypes.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+#include <avr/eeprom.h>
+#include "usbdrv.h"
+#include "keyState.h"
+#include "hidDescriptor.h"
+
+// the parts all keyboard collections share
+#define HID_KEYBOARD_MODIFIERS \
+	0x75, 0x01,						  /*	REPORT_SIZE (1) */ \
+	0x95, 0x08,						  /*	REPORT_COUNT (8) */ \
+	0x05, 0x07,						  /*	USAGE_PAGE (Keyboard)(Key Codes) */ \
+	0x19, 0xe0,						  /*	USAGE_MINIMUM (Keyboard LeftControl)(224) */ \
+	0x29, 0xe7,						  /*	USAGE_MAXIMUM (Keyboard Right GUI)(231) */ \
+	0x15, 0x00,						  /*	LOGICAL_MINIMUM (0) */ \
+	0x25, 0x01,						  /*	LOGICAL_MAXIMUM (1) */ \
+	0x81, 0x02						  /*	INPUT (Data,Var,Abs) ; Modifier byte */
+
+#define HID_KEYBOARD_LEDS \
+	0x95, 0x05,						  /*	REPORT_COUNT (5) */ \
+	0x75, 0x01,						  /*	REPORT_SIZE (1) */ \
+	0x05, 0x08,						  /*	USAGE_PAGE (LEDs) */ \
+	0x19, 0x01,						  /*	USAGE_MINIMUM (Num Lock) */ \
+	0x29, 0x05,						  /*	USAGE_MAXIMUM (Kana) */ \
+	0x91, 0x02,						  /*	OUTPUT (Data,Var,Abs) ; LED report */ \
+	0x95, 0x01,						  /*	REPORT_COUNT (1) */ \
+	0x75, 0x03,						  /*	REPORT_SIZE (3) */ \
+	0x91, 0x03						  /*	OUTPUT (Cnst,Var,Abs) ; LED report padding */
+
+// the reserved byte and six key slots of the boot report
+#define HID_KEYBOARD_SLOTS \
+	0x95, 0x01,						  /*	REPORT_COUNT (1) */ \
+	0x75, 0x08,						  /*	REPORT_SIZE (8) */ \
+	0x81, 0x03,						  /*	INPUT (Cnst,Var,Abs) ; Reserved byte */ \
+	HID_KEYBOARD_LEDS, \
+	0x95, 0x06,						  /*	REPORT_COUNT (6) */ \
+	0x75, 0x08,						  /*	REPORT_SIZE (8) */ \
+	0x15, 0x00,						  /*	LOGICAL_MINIMUM (0) */ \
+	0x26, 0xff, 0x00,				  /*	LOGICAL_MAXIMUM (255), two bytes or it is -1 */ \
+	0x05, 0x07,						  /*	USAGE_PAGE (Keyboard)(Key Codes) */ \
+	0x19, 0x00,						  /*	USAGE_MINIMUM (Reserved (no event indicated))(0) */ \
+	0x29, 0xff,						  /*	USAGE_MAXIMUM (255) */ \
+	0x81, 0x00						  /*	INPUT (Data,Ary,Abs) */
+
+// From Frank Zhao's USB Business Card project
+// http://www.frank-zhao.com/cache/usbbusinesscard_details.php
+static const uint8_t hidReportBoot[] PROGMEM = {
+	0x05, 0x01,						  // USAGE_PAGE (Generic Desktop)
+	0x09, 0x06,						  // USAGE (Keyboard)
+	0xa1, 0x01,						  // COLLECTION (Application)
+	HID_KEYBOARD_MODIFIERS,
+	HID_KEYBOARD_SLOTS,
+	0xc0									// END_COLLECTION
+};
+
+static const uint8_t hidReportNkro[] PROGMEM = {
+	0x05, 0x01,						  // USAGE_PAGE (Generic Desktop)
+	0x09, 0x06,						  // USAGE (Keyboard)
+	0xa1, 0x01,						  // COLLECTION (Application)
+	HID_KEYBOARD_MODIFIERS,
+	0x95, 0x07,						  //	REPORT_COUNT (7)
+	0x75, 0x08,						  //	REPORT_SIZE (8)
+	0x81, 0x03,						  //	INPUT (Cnst,Var,Abs) ; Reserved byte and boot keys, for boot protocol only
+	HID_KEYBOARD_LEDS,
+	0x95, 0x80,						  //	REPORT_COUNT (128)
+	0x75, 0x01,						  //	REPORT_SIZE (1)
+	0x15, 0x00,						  //	LOGICAL_MINIMUM (0)
+	0x25, 0x01,						  //	LOGICAL_MAXIMUM (1)
+	0x05, 0x07,						  //	USAGE_PAGE (Keyboard)(Key Codes)
+	0x19, 0x00,						  //	USAGE_MINIMUM (Reserved (no event indicated))(0)
+	0x29, 0x7f,						  //	USAGE_MAXIMUM (Keyboard Mute)(127)
+	0x81, 0x02,						  //	INPUT (Data,Var,Abs) ; One bit per key
+	0x95, KEYSTATE_HIGH_KEYS,		  //	REPORT_COUNT (2)
+	0x75, 0x08,						  //	REPORT_SIZE (8)
+	0x26, 0xdf, 0x00,				  //	LOGICAL_MAXIMUM (223)
+	0x19, 0x00,						  //	USAGE_MINIMUM (Reserved (no event indicated))(0)
+	0x29, 0xdf,						  //	USAGE_MAXIMUM (223)
+	0x81, 0x00,						  //	INPUT (Data,Ary,Abs) ; Volume Up and the other keys past the bitmap
+	0xc0									// END_COLLECTION
+};
+
+static const uint8_t hidReportComposite[] PROGMEM = {
+	0x05, 0x01,						  // USAGE_PAGE (Generic Desktop)
+	0x09, 0x06,						  // USAGE (Keyboard)
+	0xa1, 0x01,						  // COLLECTION (Application)
+	0x85, REPORT_ID_KEYBOARD,		  //	REPORT_ID (1)
+	HID_KEYBOARD_MODIFIERS,
+	HID_KEYBOARD_SLOTS,
+	0xc0,									// END_COLLECTION
+	0x05, 0x0c,						  // USAGE_PAGE (Consumer Devices)
+	0x09, 0x01,						  // USAGE (Consumer Control)
+	0xa1, 0x01,						  // COLLECTION (Application)
+	0x85, REPORT_ID_CONSUMER,		  //	REPORT_ID (2)
+	0x15, 0x00,						  //	LOGICAL_MINIMUM (0)
+	0x26, 0xff, 0x03,				  //	LOGICAL_MAXIMUM (1023)
+	0x19, 0x00,						  //	USAGE_MINIMUM (Unassigned)(0)
+	0x2a, 0xff, 0x03,				  //	USAGE_MAXIMUM (1023)
+	0x75, 0x10,						  //	REPORT_SIZE (16)
+	0x95, 0x01,						  //	REPORT_COUNT (1)
+	0x81, 0x00,						  //	INPUT (Data,Ary,Abs)
+	0xc0,									// END_COLLECTION
+	0x05, 0x01,						  // USAGE_PAGE (Generic Desktop)
+	0x09, 0x80,						  // USAGE (System Control)
+	0xa1, 0x01,						  // COLLECTION (Application)
+	0x85, REPORT_ID_SYSTEM,			  //	REPORT_ID (3)
+	0x15, 0x00,						  //	LOGICAL_MINIMUM (0)
+	0x26, 0xff, 0x00,				  //	LOGICAL_MAXIMUM (255)
+	0x19, 0x00,						  //	USAGE_MINIMUM (0)
+	0x29, 0xff,						  //	USAGE_MAXIMUM (255)
+	0x75, 0x08,						  //	REPORT_SIZE (8)
+	0x95, 0x01,						  //	REPORT_COUNT (1)
+	0x81, 0x00,						  //	INPUT (Data,Ary,Abs)
+	0xc0									// END_COLLECTION
+};
+
+// same as the one usbdrv.c builds, the report descriptor length is filled in
+static const uint8_t hidConfigTemplate[HID_CONFIG_LENGTH] PROGMEM = {
+	9,								// sizeof(usbDescriptorConfiguration)
+	USBDESCR_CONFIG,
+	HID_CONFIG_LENGTH, 0,			// total length including the descriptors below
+	1,								// number of interfaces
+	1,								// index of this configuration
+	0,								// configuration name string index
+#if USB_CFG_IS_SELF_POWERED
+	(1 << 7) | USBATTR_SELFPOWER,
+#else
+	(1 << 7),
+#endif
+	USB_CFG_MAX_BUS_POWER / 2,		// max USB current in 2mA units
+	// interface descriptor
+	9,
+	USBDESCR_INTERFACE,
+	0,								// index of this interface
+	0,								// alternate setting
+	USB_CFG_HAVE_INTRIN_ENDPOINT,	// endpoints excluding 0
+	USB_CFG_INTERFACE_CLASS,
+	USB_CFG_INTERFACE_SUBCLASS,
+	USB_CFG_INTERFACE_PROTOCOL,
+	0,								// string index for interface
+	// HID descriptor, at HID_DESCRIPTOR_OFFSET
+	HID_DESCRIPTOR_LENGTH,
+	USBDESCR_HID,
+	0x01, 0x01,						// HID version 1.01
+	0x00,							// target country code
+	0x01,							// one report descriptor follows
+	0x22,							// descriptor type: report
+	0, 0,							// report descriptor length, see hidDescriptorInit()
+#if USB_CFG_HAVE_INTRIN_ENDPOINT
+	// endpoint descriptor for endpoint 1
+	7,
+	USBDESCR_ENDPOINT,
+	0x81,							// IN endpoint number 1
+	0x03,							// interrupt endpoint
+	8, 0,							// maximum packet size
+	USB_CFG_INTR_POLL_INTERVAL,		// in ms
+#endif
+};
+
+uint8_t hidLayout;
+uint8_t hidLayoutSetting EEMEM = KBD_LAYOUT;
+
+static uint8_t hidConfig[HID_CONFIG_LENGTH];
+static const uint8_t *hidReport;
+static uint16_t hidReportLength;
+
+// usbFunctionDescriptor() hands the length out as a usbMsgLen_t, one byte
+// without USB_CFG_LONG_TRANSFERS, where 255 means USB_NO_MSG
+#define REPORT_FITS(report) (sizeof(report) < (usbMsgLen_t) USB_NO_MSG)
+_Static_assert(REPORT_FITS(hidReportBoot), "boot report descriptor too long");
+_Static_assert(REPORT_FITS(hidReportNkro), "NKRO report descriptor too long");
+_Static_assert(REPORT_FITS(hidReportComposite), "composite report descriptor too long");
+
+void hidDescriptorInit(void) {
+	hidLayout = eeprom_read_byte(&hidLayoutSetting);
+	if (hidLayout >= HID_LAYOUTS)
+		hidLayout = KBD_LAYOUT; // erased or garbage
+	switch (hidLayout) {
+	case HID_LAYOUT_NKRO:
+		hidReport = hidReportNkro;
+		hidReportLength = sizeof(hidReportNkro);
+		break;
+	case HID_LAYOUT_COMPOSITE:
+		hidReport = hidReportComposite;
+		hidReportLength = sizeof(hidReportComposite);
+		break;
+	default:
+		hidReport = hidReportBoot;
+		hidReportLength = sizeof(hidReportBoot);
+	}
+	memcpy_P(hidConfig, hidConfigTemplate, sizeof(hidConfig));
+	// wDescriptorLength, little endian
+	hidConfig[HID_DESCRIPTOR_OFFSET + 7] = hidReportLength;
+	hidConfig[HID_DESCRIPTOR_OFFSET + 8] = hidReportLength >> 8;
+}
+
+// called by usbdrv.c for the descriptors marked USB_PROP_IS_DYNAMIC in usbconfig.h
+usbMsgLen_t usbFunctionDescriptor(struct usbRequest *rq) {
+	switch (rq->wValue.bytes[1]) {
+	case USBDESCR_CONFIG:
+		usbMsgPtr = hidConfig;
+		return sizeof(hidConfig);
+	case USBDESCR_HID:
+		usbMsgPtr = hidConfig + HID_DESCRIPTOR_OFFSET;
+		return HID_DESCRIPTOR_LENGTH;
+	case USBDESCR_HID_REPORT:
+		// the only one in flash, see USB_CFG_DESCR_PROPS_HID_REPORT
+		usbMsgPtr = (uint8_t *)hidReport;
+		return hidReportLength;
+	}
+	return 0;
+}
@@ -0,0 +1,33 @@
+/*
+ * hidDescriptor.h - part of USBaspSunType5c
+ *
+ * Description....: Report descriptor layouts, picked at start from EEPROM
+ * Licence........: GNU GPL v3 (see LICENSE)
+ */
+
+#ifndef __hiddescriptor_h_included__
+#define __hiddescriptor_h_included__
+
+#include <stdint.h>
+#include "usbconfig.h"
+
+/* what the host is told the keyboard report looks like */
+#define HID_LAYOUT_BOOT         0   /* the 8 byte boot report, 6 key rollover */
+#define HID_LAYOUT_NKRO         1   /* boot report followed by one bit per key and the keys above 0x7f */
+#define HID_LAYOUT_COMPOSITE    2   /* boot report with ID, Consumer and System Control */
+#define HID_LAYOUTS             3
+
+/* the configuration descriptor in RAM, the HID descriptor is part of it */
+#define HID_CONFIG_LENGTH       (18 + 9 + 7 * USB_CFG_HAVE_INTRIN_ENDPOINT)
+#define HID_DESCRIPTOR_OFFSET   18
+#define HID_DESCRIPTOR_LENGTH   9
+
+/* the layout in use, only changes with the EEPROM setting and a restart
+ * because the host reads the descriptor once */
+extern uint8_t hidLayout;
+/* the EEPROM byte it is read from */
+extern uint8_t hidLayoutSetting;
+
+void hidDescriptorInit(void);
+
+#endif /* __hiddescriptor_h_included__ */
@@ -0,0 +1,143 @@
+/*
+ * keyState.c - part of USBaspSunType5c
+ *
+ * Description....: Bitmap of the Sun keys held down and the report built from it
+ * Licence........: GNU GPL v3 (see LICENSE)
+ *
+ * Make and break codes only set and clear one bit, so a repeated or missed
+ * code can never leave the report out of step with the keyboard: the report,
+ * modifiers included, is always derived from the bitmap as a whole.
+ */
+
+#include <inttypes.h>
+#include <string.h>
+#include "keycodes.h"
+#include "keymap.h"
+#include "keyState.h"
+
+// a held key is in the bitmap of the layer it was resolved in when it went
+// down, so it keeps its meaning when that layer is left before it comes up
+static uint8_t keyState[KEYMAP_LAYERS][KEYSTATE_BYTES];
+static uint8_t keyTapUsage;
+static uint8_t keyRollover;
+
+uint8_t keyStateRollovers;
+
+uint8_t keyStatePress(uint8_t code, uint8_t layer) {
+	uint8_t mask = 1 << (code & 0x07);
+
+	if (keyStateLayer(code) != KEYSTATE_NOT_HELD)
+		return 0;
+	keyState[layer][code >> 3] |= mask;
+	return 1;
+}
+
+uint8_t keyStateRelease(uint8_t code) {
+	uint8_t mask = 1 << (code & 0x07);
+	uint8_t layer = keyStateLayer(code);
+
+	if (layer == KEYSTATE_NOT_HELD)
+		return 0;
+	keyState[layer][code >> 3] &= ~mask;
+	return 1;
+}
+
+uint8_t keyStateLayer(uint8_t code) {
+	uint8_t mask = 1 << (code & 0x07);
+	uint8_t layer;
+
+	for (layer = 0; layer < KEYMAP_LAYERS; layer++) {
+		if (keyState[layer][code >> 3] & mask)
+			return layer;
+	}
+	return KEYSTATE_NOT_HELD;
+}
+
+/* a usage that is in the report without a key behind it, the tap of a tap-hold key */
+void keyStateTap(uint8_t usage) {
+	keyTapUsage = usage;
+}
+
+void keyStateReset(void) {
+	memset(keyState, 0, sizeof(keyState));
+	keyTapUsage = 0;
+}
+
+/* the NKRO part of the report, a key beyond the high key slots is left out */
+void keyStateNkroAdd(keyboard_report_t *report, uint8_t usage) {
+	uint8_t i;
+
+	if (usage < KEYSTATE_NKRO_BYTES * 8) {
+		report->usages[usage >> 3] |= 1 << (usage & 0x07);
+		return;
+	}
+	for (i = 0; i < KEYSTATE_HIGH_KEYS; i++) {
+		if (!report->highKeys[i]) {
+			report->highKeys[i] = usage;
+			return;
+		}
+	}
+}
+
+void keyStateBuildReport(keyboard_report_t *report, consumer_report_t *consumer, system_report_t *system) {
+	uint8_t layer, i, bits, code;
+	uint8_t slot = 0;
+	uint8_t rollover = 0;
+	uint16_t usage;
+	keymapEntry_t entry;
+
+	memset(report, 0, sizeof(*report));
+	report->reportId = REPORT_ID_KEYBOARD;
+	consumer->reportId = REPORT_ID_CONSUMER;
+	consumer->usage = 0;
+	system->reportId = REPORT_ID_SYSTEM;
+	system->usage = 0;
+	if (keyTapUsage) {
+		keyStateNkroAdd(report, keyTapUsage);
+		report->keycode[slot++] = keyTapUsage;
+	}
+	for (layer = 0; layer < KEYMAP_LAYERS; layer++) {
+		for (i = 0; i < KEYSTATE_BYTES; i++) {
+			bits = keyState[layer][i];
+			code = i << 3;
+			// most bytes are empty, so this is only a few iterations per key held
+			for (; bits; bits >>= 1, code++) {
+				if (!(bits & 0x01))
+					continue;
+				entry = keymapLayerLookup(layer, code);
+				usage = keymapUsage(entry);
+				switch (keymapType(entry)) {
+				case KM_TYPE_MOD:
+					report->modifier |= 1 << usage;
+					continue;
+				case KM_TYPE_CONSUMER:
+					if (!consumer->usage)
+						consumer->usage = usage;
+					continue;
+				case KM_TYPE_SYSTEM:
+					if (!system->usage)
+						system->usage = usage;
+					continue;
+				case KM_TYPE_LAYER:
+				case KM_TYPE_TAPHOLD:
+				case KM_TYPE_MACRO:
+					// only change how other keys are looked up, or play on their own
+					continue;
+				}
+				keyStateNkroAdd(report, usage);
+				// boot protocol hosts only see these
+				if (slot < sizeof(report->keycode))
+					report->keycode[slot++] = usage;
+				else
+					rollover = 1;
+			}
+		}
+	}
+	// a seventh key: no slot tells the truth any more, modifiers still do
+	if (rollover) {
+		memset(report->keycode, KEY_ERR_OVF, sizeof(report->keycode));
+		if (!keyRollover)
+			keyStateRollovers++;
+	}
+	keyRollover = rollover;
+}
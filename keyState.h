@@ -0,0 +1,64 @@
+/*
+ * keyState.h - part of USBaspSunType5c
+ *
+ * Description....: Bitmap of the Sun keys held down and the report built from it
+ * Licence........: GNU GPL v3 (see LICENSE)
+ */
+
+#ifndef __keystate_h_included__
+#define __keystate_h_included__
+
+#include <stdint.h>
+#include "usbconfig.h"
+#include "keymap.h"
+
+#define KEYSTATE_BYTES      (KEYMAP_SIZE / 8)
+/* keyboard page usages 0 - 127 as one bit each */
+#define KEYSTATE_NKRO_BYTES 16
+/* usages from 0x80 up (Volume Up, Volume Down, the international keys)
+ * as an array, modifiers have their own byte */
+#define KEYSTATE_HIGH_KEYS  2
+
+#define REPORT_ID_KEYBOARD  1
+#define REPORT_ID_CONSUMER  2
+#define REPORT_ID_SYSTEM    3
+
+/* always built in full, the layout and protocol decide which part is sent:
+ * the report ID only in the composite layout, bitmap and high keys only
+ * with NKRO */
+typedef struct {
+	uint8_t reportId;
+	uint8_t modifier;
+	uint8_t reserved;
+	uint8_t keycode[6];
+	uint8_t usages[KEYSTATE_NKRO_BYTES];
+	uint8_t highKeys[KEYSTATE_HIGH_KEYS];
+} keyboard_report_t;
+
+/* only sent in the composite layout, one key of each page at a time */
+typedef struct {
+	uint8_t reportId;
+	uint16_t usage;
+} consumer_report_t;
+
+typedef struct {
+	uint8_t reportId;
+	uint8_t usage;
+} system_report_t;
+
+/* how often more keys were held than the boot report has slots for */
+extern uint8_t keyStateRollovers;
+
+/* keyStateLayer() of a key that is not held */
+#define KEYSTATE_NOT_HELD   0xff
+
+/* set or clear the bit of a Sun scancode, returns 1 if that changed anything */
+uint8_t keyStatePress(uint8_t code, uint8_t layer);
+uint8_t keyStateRelease(uint8_t code);
+uint8_t keyStateLayer(uint8_t code);
+void keyStateTap(uint8_t usage);
+void keyStateReset(void);
+void keyStateNkroAdd(keyboard_report_t *report, uint8_t usage);
+void keyStateBuildReport(keyboard_report_t *report, consumer_report_t *consumer, system_report_t *system);
+
+#endif /* __keystate_h_included__ */
@@ -286,5 +286,29 @@
 
 // extended according to www.freebsddiary.org/APC/us_hid_usages.php
 
+/**
+ * Consumer page (0x0c) usages, sent in their own report
+ */
+#define CONSUMER_MUTE 0xe2
+#define CONSUMER_VOLUME_UP 0xe9
+#define CONSUMER_VOLUME_DOWN 0xea
+#define CONSUMER_AL_SELECT_TASK 0x1a2 // AL Select Task/Application
+#define CONSUMER_AC_OPEN 0x202
+#define CONSUMER_AC_PROPERTIES 0x209
+#define CONSUMER_AC_UNDO 0x21a
+#define CONSUMER_AC_COPY 0x21b
+#define CONSUMER_AC_CUT 0x21c
+#define CONSUMER_AC_PASTE 0x21d
+#define CONSUMER_AC_FIND 0x21f
+#define CONSUMER_AC_STOP 0x226
+#define CONSUMER_AC_REDO 0x279 // AC Redo/Repeat
+
+/**
+ * Generic desktop page (0x01) system control usages, sent in their own report
+ */
+#define SYSTEM_POWER_DOWN 0x81
+#define SYSTEM_SLEEP 0x82
+#define SYSTEM_WAKE_UP 0x83
+
 
 #endif // USB_HID_KEYS
@@ -0,0 +1,193 @@
+/*
+ * keymap.c - part of USBaspSunType5c
+ *
+ * Description....: Table driven translation of Sun scancodes to USB usages
+ * Licence........: GNU GPL v3 (see LICENSE)
+ */
+
+#include <inttypes.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+#include <avr/eeprom.h>
+#include "keycodes.h"
+#include "keymap.h"
+#include "hidDescriptor.h"
+
+const keymapEntry_t *keymapActive = keymapAnsi;
+uint8_t keymapEepromValid;
+
+// the EEPROM overrides plus the fallbacks of the layout, sorted by scancode,
+// with a bit per scancode that has one. Room for the 14 consumer and system
+// keys of keymapCommon.h on top of a full EEPROM image.
+#define KEYMAP_OVERRIDE_MAX (KEYMAP_EEPROM_MAX + 16)
+static keymapOverride_t overrides[KEYMAP_OVERRIDE_MAX];
+static uint8_t overrideCount;
+static uint8_t overridden[KEYMAP_SIZE / 8];
+
+// shipped empty but valid, see main.eep
+keymapEeprom_t keymapEeprom EEMEM = {
+	.magic = KEYMAP_EEPROM_MAGIC,
+	.count = 0,
+	.checksum = (uint8_t) -KEYMAP_EEPROM_MAGIC,
+};
+
+// scancodes not listed are unused and map to KM_NONE
+const keymapEntry_t keymapAnsi[KEYMAP_SIZE] PROGMEM = {
+#include "keymapCommon.h"
+	[0x58] = KEY_BACKSLASH, // above enter
+	[0x7c] = KEY_BACKSLASH,
+};
+
+const keymapEntry_t keymapIso[KEYMAP_SIZE] PROGMEM = {
+#include "keymapCommon.h"
+	[0x58] = KEY_HASHTILDE, // left of enter
+	[0x7c] = KEY_102ND, // right of left shift
+};
+
+// layer 1, held with compose: the numpad as a navigation block
+const keymapEntry_t keymapLayers[KEYMAP_LAYERS - 1][KEYMAP_SIZE] PROGMEM = {
+	{
+		[0x44] = KEY_HOME, // 7
+		[0x45] = KEY_UP, // 8
+		[0x46] = KEY_PAGEUP, // 9
+		[0x5b] = KEY_LEFT, // 4
+		[0x5c] = KM_MACRO(0), // 5, select all and copy
+		[0x5d] = KEY_RIGHT, // 6
+		[0x70] = KEY_END, // 1
+		[0x71] = KEY_DOWN, // 2
+		[0x72] = KEY_PAGEDOWN, // 3
+		[0x5e] = KEY_INSERT, // 0
+		[0x32] = KEY_DELETE, // .
+	},
+};
+
+// what the consumer and system keys send without reports of their own
+static const keymapEntry_t keymapFallback[][2] PROGMEM = {
+	{ KM_CONSUMER(CONSUMER_VOLUME_DOWN), KEY_VOLUMEDOWN },
+	{ KM_CONSUMER(CONSUMER_VOLUME_UP), KEY_VOLUMEUP },
+	{ KM_CONSUMER(CONSUMER_MUTE), KEY_MUTE },
+	{ KM_CONSUMER(CONSUMER_AC_STOP), KEY_STOP },
+	{ KM_CONSUMER(CONSUMER_AC_REDO), KEY_AGAIN },
+	{ KM_CONSUMER(CONSUMER_AC_PROPERTIES), KEY_PROPS },
+	{ KM_CONSUMER(CONSUMER_AC_UNDO), KEY_UNDO },
+	{ KM_CONSUMER(CONSUMER_AL_SELECT_TASK), KEY_FRONT },
+	{ KM_CONSUMER(CONSUMER_AC_COPY), KEY_COPY },
+	{ KM_CONSUMER(CONSUMER_AC_OPEN), KEY_OPEN },
+	{ KM_CONSUMER(CONSUMER_AC_PASTE), KEY_PASTE },
+	{ KM_CONSUMER(CONSUMER_AC_FIND), KEY_FIND },
+	{ KM_CONSUMER(CONSUMER_AC_CUT), KEY_CUT },
+	{ KM_SYSTEM(SYSTEM_POWER_DOWN), KEY_POWER },
+};
+
+static keymapEntry_t fallback(keymapEntry_t entry) {
+	uint8_t i;
+
+	for (i = 0; i < sizeof(keymapFallback) / sizeof(keymapFallback[0]); i++) {
+		if (pgm_read_word(&keymapFallback[i][0]) == entry)
+			return pgm_read_word(&keymapFallback[i][1]);
+	}
+	return entry;
+}
+
+static uint8_t eepromValid(uint8_t count) {
+	const uint8_t *byte = (const uint8_t *) &keymapEeprom;
+	const uint8_t *end = (const uint8_t *) &keymapEeprom.overrides[count];
+	uint8_t sum = eeprom_read_byte(&keymapEeprom.checksum);
+
+	if (eeprom_read_byte(&keymapEeprom.magic) != KEYMAP_EEPROM_MAGIC || count > KEYMAP_EEPROM_MAX)
+		return 0;
+	while (byte < end)
+		sum += eeprom_read_byte(byte++);
+	return sum == 0;
+}
+
+static uint8_t isOverridden(uint8_t code) {
+	return overridden[code >> 3] & (1 << (code & 7));
+}
+
+/* binary search, only called for scancodes with their bit set */
+static keymapEntry_t overrideOf(uint8_t code) {
+	uint8_t low = 0;
+	uint8_t high = overrideCount;
+	uint8_t middle;
+
+	while (low < high) {
+		middle = (low + high) / 2;
+		if (overrides[middle].code < code)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return overrides[low].entry;
+}
+
+/* keeps the table sorted, a later override of a scancode replaces the earlier one */
+static void addOverride(uint8_t code, keymapEntry_t entry) {
+	uint8_t i = overrideCount;
+
+	if (isOverridden(code)) {
+		while (overrides[--i].code != code) {
+		}
+		overrides[i].entry = entry;
+		return;
+	}
+	if (overrideCount == KEYMAP_OVERRIDE_MAX)
+		return;
+	for (; i > 0 && overrides[i - 1].code > code; i--)
+		overrides[i] = overrides[i - 1];
+	overrides[i].code = code;
+	overrides[i].entry = entry;
+	overrideCount++;
+	overridden[code >> 3] |= 1 << (code & 7);
+}
+
+/* all the work is done here, once per layout: the EEPROM overrides, then
+ * the fallbacks of the consumer and system keys if the report layout has
+ * no reports for them */
+void keymapLoad(void) {
+	uint8_t i, count;
+	keymapOverride_t override;
+	keymapEntry_t entry;
+
+	overrideCount = 0;
+	memset(overridden, 0, sizeof(overridden));
+	count = eeprom_read_byte(&keymapEeprom.count);
+	keymapEepromValid = eepromValid(count);
+	if (keymapEepromValid) {
+		for (i = 0; i < count; i++) {
+			eeprom_read_block(&override, &keymapEeprom.overrides[i], sizeof(override));
+			if (override.code < KEYMAP_SIZE)
+				addOverride(override.code, override.entry);
+		}
+	}
+
+	if (hidLayout == HID_LAYOUT_COMPOSITE)
+		return;
+	for (i = 0; i < KEYMAP_SIZE; i++) {
+		entry = keymapLookup(i);
+		if (keymapType(entry) == KM_TYPE_CONSUMER || keymapType(entry) == KM_TYPE_SYSTEM)
+			addOverride(i, fallback(entry));
+	}
+}
+
+/* one flash read and one bit test for a key that is not remapped */
+keymapEntry_t keymapLookup(uint8_t code) {
+	if (isOverridden(code))
+		return overrideOf(code);
+	return pgm_read_word(&keymapActive[code]);
+}
+
+/* not the hot path, only called when the keyboard tells its layout */
+void keymapSelect(uint8_t layout) {
+	switch (layout) {
+	case SUN_LAYOUT_US:
+	case SUN_LAYOUT_US_UNIX:
+	case SUN_LAYOUT_KOREA:
+	case SUN_LAYOUT_TAIWAN:
+		keymapActive = keymapAnsi;
+		break;
+	default:
+		keymapActive = keymapIso;
+	}
+	keymapLoad();
+}
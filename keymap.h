@@ -0,0 +1,109 @@
+/*
+ * keymap.h - part of USBaspSunType5c
+ *
+ * Description....: Table driven translation of Sun scancodes to USB usages
+ * Licence........: GNU GPL v3 (see LICENSE)
+ */
+
+#ifndef __keymap_h_included__
+#define __keymap_h_included__
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+#include "usbconfig.h"
+
+/* one entry per Sun scancode (make code, 0x00 - 0x7f):
+ * bits 0 - 11   HID usage, or the modifier bit number for KM_TYPE_MOD
+ * bits 12 - 14  what kind of key this is
+ * bit 15        special action: toggle the key click on make */
+typedef uint16_t keymapEntry_t;
+
+#define KEYMAP_SIZE         128
+
+#define KM_USAGE_MASK       0x0fff
+#define KM_TYPE_MASK        0x7000
+#define KM_TYPE_KEY         0x0000
+#define KM_TYPE_MOD         0x1000
+#define KM_TYPE_CONSUMER    0x2000
+#define KM_TYPE_SYSTEM      0x3000
+#define KM_TYPE_LAYER       0x4000
+#define KM_TYPE_TAPHOLD     0x5000
+#define KM_TYPE_MACRO       0x6000
+#define KM_TOGGLE_CLICK     0x8000
+
+#define KM_NONE             0
+#define KM_MOD(bit)         (KM_TYPE_MOD | (bit))
+/* turns a layer on while held */
+#define KM_LAYER(layer)     (KM_TYPE_LAYER | (layer))
+/* a layer key when held together with another key or longer than
+ * LAYER_TAP_MS, otherwise a tap of the keyboard page usage key */
+#define KM_TAPHOLD(layer, key)  (KM_TYPE_TAPHOLD | ((layer) << 8) | (key))
+/* plays sequence n of macroTable on make */
+#define KM_MACRO(number)    (KM_TYPE_MACRO | (number))
+/* layer entries not listed fall through to the layer below */
+#define KM_TRANS            0
+/* only the composite layout has reports for these, the others get the
+ * keyboard page usage keymapFallback lists for them */
+#define KM_CONSUMER(usage)  (KM_TYPE_CONSUMER | (usage))
+#define KM_SYSTEM(usage)    (KM_TYPE_SYSTEM | (usage))
+
+/* which keys of the left function cluster go out as Application Control
+ * usages (only in the composite layout), one bit each: Stop, Again, Props, Undo,
+ * Front, Copy, Open, Paste, Find, Cut. Front has no widely supported usage,
+ * so it stays a keyboard key unless asked for. */
+#ifndef KBD_AC_KEYS
+#define KBD_AC_KEYS         0x03ef
+#endif
+#define KM_AC(bit, usage, key)  ((KBD_AC_KEYS & (1 << (bit))) ? KM_CONSUMER(usage) : (key))
+
+#define keymapUsage(entry)  ((entry) & KM_USAGE_MASK)
+#define keymapType(entry)   ((entry) & KM_TYPE_MASK)
+#define keymapTapLayer(entry)   (((entry) >> 8) & 0x0f)
+#define keymapTapUsage(entry)   ((entry) & 0xff)
+
+/* layout bytes of the Type 5 keyboards with the ANSI key arrangement, all the
+ * others (Germany 0x25, UK 0x2e, ...) have the ISO one */
+#define SUN_LAYOUT_US       0x21
+#define SUN_LAYOUT_US_UNIX  0x22
+#define SUN_LAYOUT_KOREA    0x2f
+#define SUN_LAYOUT_TAIWAN   0x30
+
+/* user remapping in EEPROM (make eeprom), applied on top of the layout table.
+ * The image is only used when the magic matches, count is in range and the
+ * bytes of magic, count, the used overrides and checksum add up to 0. */
+#define KEYMAP_EEPROM_MAGIC 0x5c
+#define KEYMAP_EEPROM_MAX   32
+
+typedef struct {
+	uint8_t code;
+	keymapEntry_t entry;
+} keymapOverride_t;
+
+typedef struct {
+	uint8_t magic;
+	uint8_t count;
+	keymapOverride_t overrides[KEYMAP_EEPROM_MAX];
+	uint8_t checksum;
+} keymapEeprom_t;
+
+extern const keymapEntry_t keymapAnsi[KEYMAP_SIZE] PROGMEM;
+extern const keymapEntry_t keymapIso[KEYMAP_SIZE] PROGMEM;
+/* layer 0 is the layout table, the ones above it are the same for every
+ * layout and are not remapped by the EEPROM */
+#define KEYMAP_LAYERS       2
+extern const keymapEntry_t keymapLayers[KEYMAP_LAYERS - 1][KEYMAP_SIZE] PROGMEM;
+/* points into flash, picked by the layout byte of the keyboard */
+extern const keymapEntry_t *keymapActive;
+/* 1 if the EEPROM image was valid on the last keymapLoad() */
+extern uint8_t keymapEepromValid;
+
+void keymapLoad(void);
+void keymapSelect(uint8_t layout);
+
+/* the active table with the EEPROM overrides and the fallbacks of the
+ * report layout, as keymapLoad() resolved them */
+keymapEntry_t keymapLookup(uint8_t code);
+#define keymapLayerLookup(layer, code) \
+	((layer) ? pgm_read_word(&keymapLayers[(layer) - 1][(code)]) : keymapLookup(code))
+
+#endif /* __keymap_h_included__ */
@@ -0,0 +1,126 @@
+/*
+ * keymapCommon.h - part of USBaspSunType5c
+ *
+ * Description....: Keymap entries shared by all layouts, only for keymap.c
+ * Licence........: GNU GPL v3 (see LICENSE)
+ *
+ * This is the body of a designated initializer, keymap.c includes it into
+ * every layout table and adds the keys that differ between layouts.
+ */
+
+	[0x01] = KM_AC(0, CONSUMER_AC_STOP, KEY_STOP), // stop
+	[0x02] = KM_CONSUMER(CONSUMER_VOLUME_DOWN),
+	[0x03] = KM_AC(1, CONSUMER_AC_REDO, KEY_AGAIN), // wiederholen (again)
+	[0x04] = KM_CONSUMER(CONSUMER_VOLUME_UP),
+	[0x05] = KEY_F1,
+	[0x06] = KEY_F2,
+	[0x07] = KEY_F10,
+	[0x08] = KEY_F3,
+	[0x09] = KEY_F11,
+	[0x0a] = KEY_F4,
+	[0x0b] = KEY_F12,
+	[0x0c] = KEY_F5,
+	[0x0d] = KM_MOD(6), // alt right (graph)
+	[0x0e] = KEY_F6,
+	[0x10] = KEY_F7,
+	[0x11] = KEY_F8,
+	[0x12] = KEY_F9,
+	[0x13] = KM_MOD(2), // alt left
+	[0x14] = KEY_UP,
+	[0x15] = KEY_PAUSE,
+	[0x16] = KEY_SYSRQ,
+	[0x17] = KEY_SCROLLLOCK,
+	[0x18] = KEY_LEFT,
+	[0x19] = KM_AC(2, CONSUMER_AC_PROPERTIES, KEY_PROPS), // eigenschaften (props)
+	[0x1a] = KM_AC(3, CONSUMER_AC_UNDO, KEY_UNDO), // Zurücksetzen (undo)
+	[0x1b] = KEY_DOWN,
+	[0x1c] = KEY_RIGHT,
+	[0x1d] = KEY_ESC,
+	[0x1e] = KEY_1,
+	[0x1f] = KEY_2,
+	[0x20] = KEY_3,
+	[0x21] = KEY_4,
+	[0x22] = KEY_5,
+	[0x23] = KEY_6,
+	[0x24] = KEY_7,
+	[0x25] = KEY_8,
+	[0x26] = KEY_9,
+	[0x27] = KEY_0,
+	[0x28] = KEY_MINUS,
+	[0x29] = KEY_EQUAL,
+	[0x2a] = KEY_GRAVE,
+	[0x2b] = KEY_BACKSPACE,
+	[0x2c] = KEY_INSERT,
+	[0x2d] = KM_CONSUMER(CONSUMER_MUTE),
+	[0x2e] = KEY_KPSLASH,
+	[0x2f] = KEY_KPASTERISK,
+	[0x30] = KM_SYSTEM(SYSTEM_POWER_DOWN),
+	[0x31] = KM_AC(4, CONSUMER_AL_SELECT_TASK, KEY_FRONT), // Vordergrung (front)
+	[0x32] = KEY_KPDOT,
+	[0x33] = KM_AC(5, CONSUMER_AC_COPY, KEY_COPY), // Kopieren (copy)
+	[0x34] = KEY_HOME,
+	[0x35] = KEY_TAB,
+	[0x36] = KEY_Q,
+	[0x37] = KEY_W,
+	[0x38] = KEY_E,
+	[0x39] = KEY_R,
+	[0x3a] = KEY_T,
+	[0x3b] = KEY_Y,
+	[0x3c] = KEY_U,
+	[0x3d] = KEY_I,
+	[0x3e] = KEY_O,
+	[0x3f] = KEY_P,
+	[0x40] = KEY_LEFTBRACE,
+	[0x41] = KEY_RIGHTBRACE,
+	[0x43] = KM_TAPHOLD(1, KEY_COMPOSE), // compose, held it is the layer 1 key
+	[0x44] = KEY_KP7,
+	[0x45] = KEY_KP8,
+	[0x46] = KEY_KP9,
+	[0x47] = KEY_KPMINUS,
+	[0x48] = KM_AC(6, CONSUMER_AC_OPEN, KEY_OPEN), // Öffnen (open)
+	[0x49] = KM_AC(7, CONSUMER_AC_PASTE, KEY_PASTE), // Einsetzen (paste)
+	[0x4a] = KEY_END,
+	[0x4c] = KM_MOD(0), // left crtl
+	[0x4d] = KEY_A,
+	[0x4e] = KEY_S,
+	[0x4f] = KEY_D,
+	[0x50] = KEY_F,
+	[0x51] = KEY_G,
+	[0x52] = KEY_H,
+	[0x53] = KEY_J,
+	[0x54] = KEY_K,
+	[0x55] = KEY_L,
+	[0x56] = KEY_SEMICOLON,
+	[0x57] = KEY_APOSTROPHE,
+	[0x59] = KEY_ENTER,
+	[0x5a] = KEY_KPENTER,
+	[0x5b] = KEY_KP4,
+	[0x5c] = KEY_KP5,
+	[0x5d] = KEY_KP6,
+	[0x5e] = KEY_KP0,
+	[0x5f] = KM_AC(8, CONSUMER_AC_FIND, KEY_FIND), // Suchen (find)
+	[0x60] = KEY_PAGEUP,
+	[0x61] = KM_AC(9, CONSUMER_AC_CUT, KEY_CUT), // Ausschneiden (cut)
+	[0x62] = KEY_NUMLOCK,
+	[0x63] = KM_MOD(5), // left shift
+	[0x64] = KEY_Z,
+	[0x65] = KEY_X,
+	[0x66] = KEY_C,
+	[0x67] = KEY_V,
+	[0x68] = KEY_B,
+	[0x69] = KEY_N,
+	[0x6a] = KEY_M,
+	[0x6b] = KEY_COMMA,
+	[0x6c] = KEY_DOT,
+	[0x6d] = KEY_SLASH,
+	[0x6e] = KM_MOD(1), // right shift
+	[0x70] = KEY_KP1,
+	[0x71] = KEY_KP2,
+	[0x72] = KEY_KP3,
+	[0x76] = KEY_HELP | KM_TOGGLE_CLICK, // help
+	[0x77] = KEY_CAPSLOCK,
+	[0x78] = KM_MOD(3), // meta left
+	[0x79] = KEY_SPACE,
+	[0x7a] = KM_MOD(7), // meta right
+	[0x7b] = KEY_PAGEDOWN,
+	[0x7d] = KEY_KPPLUS,
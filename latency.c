@@ -0,0 +1,59 @@
+/*
+ * latency.c - part of USBaspSunType5c
+ *
+ * Description....: Histogram of the time from key to host
+ * Licence........: GNU GPL v3 (see LICENSE)
+ *
+ * Every stage is timed against the start bit edge the receiver interrupt
+ * saw, in timer 1 ticks. Those wrap after 43.7 ms. Decoding and building
+ * the report stay well below that, but the host taking it does not: a
+ * 26 byte NKRO report alone takes four 10 ms polls. So that stage keeps
+ * the millisecond count of the edge too, which tells the number of wraps.
+ * Read with the diagnostics interface, see diag.c.
+ */
+
+#include <inttypes.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+#include "clock.h"
+#include "latency.h"
+
+#define TICKS(ms) ((uint32_t) (ms) * LATENCY_TICKS_PER_MS)
+
+static const uint32_t bounds[LATENCY_BUCKETS - 1] PROGMEM = { LATENCY_BOUNDS(TICKS) };
+
+latencyStats_t latencyStats;
+
+static void record(uint8_t stage, uint32_t latency) {
+	uint8_t bucket = 0;
+
+	while (bucket < LATENCY_BUCKETS - 1 && latency >= pgm_read_dword(&bounds[bucket]))
+		bucket++;
+	// saturate, a stuck counter is easier to spot than a wrapped one
+	if (latencyStats.count[stage][bucket] != 0xffff)
+		latencyStats.count[stage][bucket]++;
+	if (latency > latencyStats.max[stage])
+		latencyStats.max[stage] = latency;
+}
+
+void latencyRecord(uint8_t stage, uint16_t edge, uint16_t now) {
+	record(stage, (uint16_t) (now - edge));
+}
+
+uint16_t latencyEdgeMillis(uint16_t edge) {
+	return clockMillis() - (uint16_t) (clockTicks() - edge) / LATENCY_TICKS_PER_MS;
+}
+
+/* timer 1 has the ticks modulo 65536, the milliseconds the rough total,
+ * which is good enough to pick the number of wraps */
+void latencyRecordLong(uint8_t stage, uint16_t edge, uint16_t edgeMillis, uint16_t now) {
+	uint32_t rough = (uint32_t) (uint16_t) (clockMillis() - edgeMillis) * LATENCY_TICKS_PER_MS;
+	uint16_t ticks = now - edge;
+	int32_t wraps = ((int32_t) rough - ticks + 0x8000) >> 16;
+
+	record(stage, ticks + (wraps > 0 ? (uint32_t) wraps << 16 : 0));
+}
+
+void latencyClear(void) {
+	memset(&latencyStats, 0, sizeof(latencyStats));
+}
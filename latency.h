@@ -0,0 +1,27 @@
+/*
+ * latency.h - part of USBaspSunType5c
+ *
+ * Description....: Histogram of the time from key to host
+ * Licence........: GNU GPL v3 (see LICENSE)
+ */
+
+#ifndef __latency_h_included__
+#define __latency_h_included__
+
+#include <stdint.h>
+#include "diagProtocol.h"
+
+/* timer 1 runs at 1.5 MHz, see clockInit() */
+#define LATENCY_TICKS_PER_MS 1500
+
+extern latencyStats_t latencyStats;
+
+/* for stages that end less than 43.7 ms after the edge, one timer 1 round */
+void latencyRecord(uint8_t stage, uint16_t edge, uint16_t now);
+/* clockMillis() at an edge less than 43.7 ms ago, to within a few ms */
+uint16_t latencyEdgeMillis(uint16_t edge);
+/* for stages of any length, edgeMillis tells how often timer 1 wrapped */
+void latencyRecordLong(uint8_t stage, uint16_t edge, uint16_t edgeMillis, uint16_t now);
+void latencyClear(void);
+
+#endif /* __latency_h_included__ */
@@ -0,0 +1,98 @@
+/*
+ * layer.c - part of USBaspSunType5c
+ *
+ * Description....: Keymap layers and tap-hold keys
+ * Licence........: GNU GPL v3 (see LICENSE)
+ *
+ * Every layer above 0 is a table of its own, a make code is looked up in
+ * the topmost layer that is on and does not leave the key transparent.
+ * Whether a tap-hold key is tapped or held is only decided later, by the
+ * next make code or by the millisecond clock in the main loop, so nothing
+ * here ever waits.
+ */
+
+#include <inttypes.h>
+#include "clock.h"
+#include "keymap.h"
+#include "layer.h"
+
+#define LAYER_NO_TAP        0xff
+
+uint8_t layerMask;
+
+static uint8_t tapCode = LAYER_NO_TAP;
+static uint8_t tapLayer;
+static uint16_t tapTime;
+
+/* the layer the make code of this scancode is looked up in */
+uint8_t layerResolve(uint8_t code) {
+	uint8_t layer;
+
+	// the usual case, nothing but the layout table
+	if (!layerMask)
+		return 0;
+	for (layer = KEYMAP_LAYERS - 1; layer > 0; layer--) {
+		if ((layerMask & (1 << layer)) && keymapLayerLookup(layer, code) != KM_TRANS)
+			return layer;
+	}
+	return 0;
+}
+
+static void tapToHold(void) {
+	if (tapLayer < KEYMAP_LAYERS)
+		layerMask |= 1 << tapLayer;
+	tapCode = LAYER_NO_TAP;
+}
+
+/* another key going down makes a pending tap-hold key a hold, call before
+ * layerResolve() so that key already sees the layer */
+void layerKeyDown(void) {
+	if (tapCode != LAYER_NO_TAP)
+		tapToHold();
+}
+
+/* handles the make and break codes of layer and tap-hold keys, returns the
+ * usage to tap when a tap-hold key came up before it turned into a hold */
+uint8_t layerKey(uint8_t code, keymapEntry_t entry, uint8_t isMake) {
+	uint8_t layer;
+
+	switch (keymapType(entry)) {
+	case KM_TYPE_LAYER:
+		layer = keymapUsage(entry);
+		break;
+	case KM_TYPE_TAPHOLD:
+		layer = keymapTapLayer(entry);
+		if (isMake) {
+			tapCode = code;
+			tapLayer = layer;
+			tapTime = clockMillis();
+			return 0;
+		}
+		if (tapCode == code) {
+			tapCode = LAYER_NO_TAP;
+			return keymapTapUsage(entry);
+		}
+		break;
+	default:
+		return 0;
+	}
+	if (layer >= KEYMAP_LAYERS)
+		return 0;
+	if (isMake)
+		layerMask |= 1 << layer;
+	else
+		layerMask &= ~(1 << layer);
+	return 0;
+}
+
+/* call from the main loop, a tap-hold key held long enough is a hold */
+void layerPoll(void) {
+	if (tapCode != LAYER_NO_TAP
+			&& (uint16_t) (clockMillis() - tapTime) >= LAYER_TAP_MS)
+		tapToHold();
+}
+
+void layerReset(void) {
+	layerMask = 0;
+	tapCode = LAYER_NO_TAP;
+}
@@ -0,0 +1,26 @@
+/*
+ * layer.h - part of USBaspSunType5c
+ *
+ * Description....: Keymap layers and tap-hold keys
+ * Licence........: GNU GPL v3 (see LICENSE)
+ */
+
+#ifndef __layer_h_included__
+#define __layer_h_included__
+
+#include <stdint.h>
+#include "keymap.h"
+
+/* a tap-hold key held this long without another key is a hold */
+#define LAYER_TAP_MS        200
+
+/* bit n set while layer n is on, layer 0 is always on and has no bit */
+extern uint8_t layerMask;
+
+uint8_t layerResolve(uint8_t code);
+void layerKeyDown(void);
+uint8_t layerKey(uint8_t code, keymapEntry_t entry, uint8_t isMake);
+void layerPoll(void);
+void layerReset(void);
+
+#endif /* __layer_h_included__ */
@@ -0,0 +1,63 @@
+/*
+ * macro.c - part of USBaspSunType5c
+ *
+ * Description....: Stored keyboard report sequences played back on a key
+ * Licence........: GNU GPL v3 (see LICENSE)
+ *
+ * A sequence is a list of complete keyboard states in flash. The main loop
+ * asks for the next one only when the report queue is empty and the
+ * interrupt endpoint is free, so every state reaches the host in its own
+ * transfer, at the poll rate, while usbPoll() and the keyboard line keep
+ * being served in between.
+ */
+
+#include <inttypes.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+#include "keycodes.h"
+#include "macro.h"
+
+// modifier bits of the report
+#define MOD_LCTRL           0x01
+
+// 0: select all and copy
+static const macroStep_t macroCopyAll[] PROGMEM = {
+	MACRO_TAP(MOD_LCTRL, KEY_A),
+	MACRO_TAP(MOD_LCTRL, KEY_C),
+	MACRO_END
+};
+
+const macroStep_t *const macroTable[] PROGMEM = {
+	macroCopyAll,
+};
+#define MACRO_COUNT (sizeof(macroTable) / sizeof(macroTable[0]))
+
+static const macroStep_t *macroStep;
+
+void macroStart(uint8_t number) {
+	if (number < MACRO_COUNT)
+		macroStep = pgm_read_ptr(&macroTable[number]);
+}
+
+uint8_t macroPlaying(void) {
+	return macroStep != 0;
+}
+
+/* the next report of the sequence playing, returns 0 and stops at its end */
+uint8_t macroNext(keyboard_report_t *report) {
+	macroStep_t step;
+
+	memcpy_P(&step, macroStep, sizeof(step));
+	if (step.modifier == 0xff) {
+		macroStep = 0;
+		return 0;
+	}
+	macroStep++;
+
+	memset(report, 0, sizeof(*report));
+	report->reportId = REPORT_ID_KEYBOARD;
+	report->modifier = step.modifier;
+	report->keycode[0] = step.key;
+	keyStateNkroAdd(report, step.key);
+	return 1;
+}
@@ -0,0 +1,33 @@
+/*
+ * macro.h - part of USBaspSunType5c
+ *
+ * Description....: Stored keyboard report sequences played back on a key
+ * Licence........: GNU GPL v3 (see LICENSE)
+ */
+
+#ifndef __macro_h_included__
+#define __macro_h_included__
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+#include "keyState.h"
+
+/* one report of a sequence: the modifier byte and at most one key */
+typedef struct {
+	uint8_t modifier;
+	uint8_t key;
+} macroStep_t;
+
+/* ends every sequence, no report is sent for it */
+#define MACRO_END           { 0xff, 0xff }
+/* press and release, the usual way to type one key */
+#define MACRO_TAP(modifier, key)    { (modifier), (key) }, { 0, 0 }
+
+/* the sequences KM_MACRO(n) entries play, in flash */
+extern const macroStep_t *const macroTable[] PROGMEM;
+
+void macroStart(uint8_t number);
+uint8_t macroPlaying(void);
+uint8_t macroNext(keyboard_report_t *report);
+
+#endif /* __macro_h_included__ */
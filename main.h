@@ -7,22 +7,26 @@
 #define SCROLL_LOCK 0x04
 #define COMPOSE		0x08
 
+// the LED output report, with the report ID in front in the composite layout
+#define LED_REPORT_LENGTH	2
+
+// wValue of GET_PROTOCOL / SET_PROTOCOL
+#define HID_PROTOCOL_BOOT	0
+#define HID_PROTOCOL_REPORT	1
+// modifier, reserved and six key slots, no report ID
+#define HID_BOOT_REPORT_LENGTH	8
+
 
 #define STATE_WAIT 0
 #define STATE_SEND_KEY 1
 #define STATE_RELEASE_KEY 2
 
 usbMsgLen_t usbFunctionSetup(uint8_t data[8]);
-void sendToKeyboard(uint8_t toSend, uint8_t isLastOne);
 usbMsgLen_t usbFunctionWrite(uint8_t * data, uint8_t len);
-void key_down(uint8_t down_key);
-void key_up(uint8_t up_key);
-void toggleModifier(uint8_t key);
-void resetKeysDown();
-uint8_t map(uint8_t keyCodeIn);
-void parseKeyboardResponse();
-void emergencyParse();
-void startReading();
+uchar usbFunctionRead(uchar *data, uchar len);
+void hadUsbReset();
+void publishReport();
+void parseKeyboardResponse(uint8_t response);
 int main();
 
 #endif
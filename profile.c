@@ -0,0 +1,55 @@
+/*
+ * profile.c - part of USBaspSunType5c
+ *
+ * Description....: Optional time accounting of the main loop stages
+ * Licence........: GNU GPL v3 (see LICENSE)
+ *
+ * Each stage is timed from the end of the one before, so the stages add up
+ * to the whole iteration, profiling included. V-USB wants usbPoll() at
+ * least every 50 ms; the iteration histogram shows how much of that is left
+ * while typing.
+ */
+
+#include <inttypes.h>
+#include <avr/pgmspace.h>
+#include "clock.h"
+#include "profile.h"
+
+#if KBD_LOOP_PROFILE
+#define TICKS(us) ((uint32_t) (us) * CLOCK_T1_1ms / 1000)
+
+static const uint32_t bounds[LOOP_BUCKETS - 1] PROGMEM = { LOOP_BOUNDS(TICKS) };
+
+loopStats_t loopStats;
+
+static uint16_t lastTicks;
+static uint32_t iterationTicks;
+
+void profileInit(void) {
+	lastTicks = clockTicks();
+}
+
+void profileStage(uint8_t stage) {
+	uint16_t now = clockTicks();
+	uint16_t ticks = now - lastTicks;
+
+	lastTicks = now;
+	iterationTicks += ticks;
+	if (ticks > loopStats.stageMax[stage])
+		loopStats.stageMax[stage] = ticks;
+	loopStats.stageSum[stage] += ticks;
+}
+
+void profileIteration(void) {
+	uint8_t bucket = 0;
+
+	while (bucket < LOOP_BUCKETS - 1 && iterationTicks >= pgm_read_dword(&bounds[bucket]))
+		bucket++;
+	if (loopStats.buckets[bucket] != 0xffff)
+		loopStats.buckets[bucket]++;
+	if (iterationTicks > loopStats.maxIteration)
+		loopStats.maxIteration = iterationTicks;
+	loopStats.iterations++;
+	iterationTicks = 0;
+}
+#endif
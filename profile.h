@@ -0,0 +1,33 @@
+/*
+ * profile.h - part of USBaspSunType5c
+ *
+ * Description....: Optional time accounting of the main loop stages
+ * Licence........: GNU GPL v3 (see LICENSE)
+ */
+
+#ifndef __profile_h_included__
+#define __profile_h_included__
+
+#include <stdint.h>
+#include "diagProtocol.h"
+
+/* Set KBD_LOOP_PROFILE to 1 (e.g. -DKBD_LOOP_PROFILE=1 in the Makefile's
+ * CFLAGS) to time every stage of the main loop with timer 1. Off by default,
+ * it reads the timer four times per iteration. */
+#ifndef KBD_LOOP_PROFILE
+#define KBD_LOOP_PROFILE    0
+#endif
+
+#if KBD_LOOP_PROFILE
+extern loopStats_t loopStats;
+
+void profileInit(void);
+void profileStage(uint8_t stage);
+void profileIteration(void);
+#else
+#define profileInit()
+#define profileStage(stage)
+#define profileIteration()
+#endif
+
+#endif /* __profile_h_included__ */
@@ -0,0 +1,107 @@
+/*
+ * reportQueue.c - part of USBaspSunType5c
+ *
+ * Description....: FIFO of report snapshots for the interrupt endpoint
+ * Licence........: GNU GPL v3 (see LICENSE)
+ *
+ * The host polls the interrupt endpoint every 10 ms, so a key tapped faster
+ * than that would never show up if only the latest state was sent. Every
+ * state change queues its own snapshot instead and the main loop hands out
+ * one per interrupt transfer. Both sides run in the main loop.
+ *
+ * When the queue is full a snapshot is dropped, but the host must still
+ * end up with the latest state of every report, or a released key stays
+ * down. So the report is remembered by kind and queued again from the
+ * caller's copy of its latest state as soon as a slot is free.
+ */
+
+#include <inttypes.h>
+#include <string.h>
+#include "keyState.h"
+#include "reportQueue.h"
+
+#define REPORTQUEUE_MASK (REPORTQUEUE_SIZE - 1)
+
+typedef struct {
+	uint8_t length;
+	uint8_t timed;
+	uint16_t edge;
+	uint16_t edgeMillis;
+	uint8_t data[REPORTQUEUE_MAX_LENGTH];
+} queueEntry_t;
+
+static queueEntry_t queue[REPORTQUEUE_SIZE];
+static uint8_t queueHead;
+static uint8_t queueTail;
+// reports dropped since their last snapshot went in, and where their latest state is
+static const void *lostReport[REPORTQUEUE_KINDS];
+static uint8_t lostLength[REPORTQUEUE_KINDS];
+
+uint8_t reportQueueOverflows;
+
+static uint8_t queueFull(void) {
+	return ((queueHead + 1) & REPORTQUEUE_MASK) == queueTail;
+}
+
+/* report must stay where it is and hold the latest state of its kind, it is
+ * read again if the queue is full. Returns 1 if the snapshot was queued. */
+uint8_t reportQueuePush(uint8_t reportId, const void *report, uint8_t length) {
+	queueEntry_t *entry = &queue[queueHead];
+
+	if (queueFull()) {
+		reportQueueOverflows++;
+		lostReport[reportId - 1] = report;
+		lostLength[reportId - 1] = length;
+		return 0;
+	}
+	// newer than whatever was dropped before
+	lostReport[reportId - 1] = 0;
+	entry->length = length;
+	entry->timed = 0;
+	memcpy(entry->data, report, length);
+	queueHead = (queueHead + 1) & REPORTQUEUE_MASK;
+	return 1;
+}
+
+/* drops every snapshot, the dropped reports are not sent again either */
+void reportQueueClear(void) {
+	queueTail = queueHead;
+	memset(lostReport, 0, sizeof(lostReport));
+}
+
+/* the newest snapshot was caused by the key whose start bit came at edge,
+ * timer 1 ticks and clockMillis() of it, see latency.c */
+void reportQueueTime(uint16_t edge, uint16_t edgeMillis) {
+	queueEntry_t *entry = &queue[(queueHead - 1) & REPORTQUEUE_MASK];
+
+	entry->timed = 1;
+	entry->edge = edge;
+	entry->edgeMillis = edgeMillis;
+}
+
+uint8_t reportQueueEmpty(void) {
+	return queueHead == queueTail;
+}
+
+const uint8_t *reportQueuePeek(uint8_t *length) {
+	*length = queue[queueTail].length;
+	return queue[queueTail].data;
+}
+
+/* returns 1 and the start bit edge if the oldest snapshot came from a key */
+uint8_t reportQueuePeekEdge(uint16_t *edge, uint16_t *edgeMillis) {
+	*edge = queue[queueTail].edge;
+	*edgeMillis = queue[queueTail].edgeMillis;
+	return queue[queueTail].timed;
+}
+
+void reportQueuePop(void) {
+	uint8_t i;
+
+	queueTail = (queueTail + 1) & REPORTQUEUE_MASK;
+	// room again for the reports that did not fit
+	for (i = 0; i < REPORTQUEUE_KINDS && !queueFull(); i++) {
+		if (lostReport[i])
+			reportQueuePush(i + 1, lostReport[i], lostLength[i]);
+	}
+}
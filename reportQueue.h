@@ -0,0 +1,34 @@
+/*
+ * reportQueue.h - part of USBaspSunType5c
+ *
+ * Description....: FIFO of report snapshots for the interrupt endpoint
+ * Licence........: GNU GPL v3 (see LICENSE)
+ */
+
+#ifndef __reportqueue_h_included__
+#define __reportqueue_h_included__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "keyState.h"
+
+/* snapshots waiting for the host, must be a power of two */
+#define REPORTQUEUE_SIZE    8
+/* the NKRO keyboard report is the longest one, it goes out without report ID */
+#define REPORTQUEUE_MAX_LENGTH (sizeof(keyboard_report_t) - offsetof(keyboard_report_t, modifier))
+
+/* one kind of report each, indexed by report ID */
+#define REPORTQUEUE_KINDS   3
+
+/* snapshots dropped because the queue was full */
+extern uint8_t reportQueueOverflows;
+
+uint8_t reportQueuePush(uint8_t reportId, const void *report, uint8_t length);
+void reportQueueClear(void);
+void reportQueueTime(uint16_t edge, uint16_t edgeMillis);
+uint8_t reportQueueEmpty(void);
+const uint8_t *reportQueuePeek(uint8_t *length);
+uint8_t reportQueuePeekEdge(uint16_t *edge, uint16_t *edgeMillis);
+void reportQueuePop(void);
+
+#endif /* __reportqueue_h_included__ */
@@ -0,0 +1,82 @@
+/*
+ * sunProtocol.c - part of USBaspSunType5c
+ *
+ * Description....: Reset and response handshake with the Sun keyboard
+ * Licence........: GNU GPL v3 (see LICENSE)
+ *
+ * After power on or a reset command the keyboard sends 0xff, its ID (0x04)
+ * and then the make codes of any keys held followed by 0x7f. A layout
+ * request is answered with 0xfe and the layout byte, a failed self test
+ * with 0x7e and an error code. 0xff can come at any time when the keyboard
+ * is plugged in again, so it restarts the handshake from every state.
+ */
+
+#include <inttypes.h>
+#include "clock.h"
+#include "sunRx.h"
+#include "sunTx.h"
+#include "sunProtocol.h"
+#include "trace.h"
+
+static uint8_t protoState;
+static uint16_t resetTime;
+
+uint8_t sunLayout;
+uint8_t sunKeyboardErrors;
+
+/* ask the keyboard to start over, key codes are ignored until it did */
+void sunProtocolReset(void) {
+	protoState = SUNPROTO_RESET;
+	resetTime = clockMillis();
+	sunTxCommand(SUNTX_SLOT_RESET, SUN_CMD_RESET);
+}
+
+/* call from the main loop, retries the reset of a keyboard that is not there */
+void sunProtocolPoll(void) {
+	if (protoState == SUNPROTO_RESET
+			&& (uint16_t) (clockMillis() - resetTime) >= SUNPROTO_RETRY_MS)
+		sunProtocolReset();
+}
+
+uint8_t sunProtocolParse(uint8_t response) {
+	if (response == SUN_RESP_RESET) {
+		protoState = SUNPROTO_ID;
+		return SUN_EVENT_NONE;
+	}
+
+	switch (protoState) {
+	case SUNPROTO_RESET:
+		return SUN_EVENT_NONE;
+	case SUNPROTO_ID:
+		if (response != SUN_KEYBOARD_ID) {
+			// not what a Type 5 says, try again
+			sunKeyboardErrors++;
+			traceEvent(TRACE_ERROR, TRACE_KEYBOARD, DIAG_TRACE_BAD_ID, response);
+			sunProtocolReset();
+			return SUN_EVENT_NONE;
+		}
+		protoState = SUNPROTO_READY;
+		return SUN_EVENT_RESET;
+	case SUNPROTO_LAYOUT:
+		sunLayout = response;
+		protoState = SUNPROTO_READY;
+		return SUN_EVENT_LAYOUT;
+	case SUNPROTO_ERROR:
+		// the self test failed, the error code itself tells us nothing more
+		sunKeyboardErrors++;
+		sunProtocolReset();
+		return SUN_EVENT_NONE;
+	}
+
+	switch (response) {
+	case SUN_RESP_LAYOUT:
+		protoState = SUNPROTO_LAYOUT;
+		return SUN_EVENT_NONE;
+	case SUN_RESP_ERROR:
+		protoState = SUNPROTO_ERROR;
+		return SUN_EVENT_NONE;
+	case SUN_RESP_IDLE:
+		return SUN_EVENT_ALL_UP;
+	}
+	return SUN_EVENT_KEY;
+}
@@ -0,0 +1,39 @@
+/*
+ * sunProtocol.h - part of USBaspSunType5c
+ *
+ * Description....: Reset and response handshake with the Sun keyboard
+ * Licence........: GNU GPL v3 (see LICENSE)
+ */
+
+#ifndef __sunprotocol_h_included__
+#define __sunprotocol_h_included__
+
+#include <stdint.h>
+
+/* what sunProtocolParse() made of a byte from the keyboard */
+#define SUN_EVENT_NONE      0   /* part of a handshake, nothing to do */
+#define SUN_EVENT_KEY       1   /* a make or break code for the keymap */
+#define SUN_EVENT_ALL_UP    2   /* no key is held any more */
+#define SUN_EVENT_RESET     3   /* the keyboard (re)started, it forgot LEDs and click */
+#define SUN_EVENT_LAYOUT    4   /* sunLayout was updated */
+
+/* protocol states */
+#define SUNPROTO_RESET      0   /* waiting for the reset response */
+#define SUNPROTO_ID         1   /* next byte is the keyboard ID */
+#define SUNPROTO_READY      2   /* key codes */
+#define SUNPROTO_LAYOUT     3   /* next byte is the layout */
+#define SUNPROTO_ERROR      4   /* next byte is the error code */
+
+#define SUN_KEYBOARD_ID     0x04
+
+/* no reset response for this long, ask again */
+#define SUNPROTO_RETRY_MS   1000
+
+extern uint8_t sunLayout;
+extern uint8_t sunKeyboardErrors;
+
+void sunProtocolReset(void);
+void sunProtocolPoll(void);
+uint8_t sunProtocolParse(uint8_t response);
+
+#endif /* __sunprotocol_h_included__ */
@@ -0,0 +1,143 @@
+/*
+ * sunRx.c - part of USBaspSunType5c
+ *
+ * Description....: Interrupt driven receiver for the Sun keyboard line
+ * Licence........: GNU GPL v3 (see LICENSE)
+ *
+ * Timer 1 compare A drives a small state machine: while idle it polls the
+ * line for a start bit, once one is seen it samples the middle of every
+ * following bit. The sample deadlines are absolute timer values counted from
+ * the estimated start bit edge, so USB interrupts delaying one sample can not
+ * push the following ones towards the bit edges. Finished bytes go into a
+ * single producer / single consumer ring buffer, the interrupt only ever
+ * writes rxHead and the main loop only ever writes rxTail, so neither side
+ * needs to disable interrupts.
+ */
+
+#include <inttypes.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "clock.h"
+#include "sunRx.h"
+#include "trace.h"
+
+#define SUNRX_BUFFER_MASK (SUNRX_BUFFER_SIZE - 1)
+
+static volatile uint8_t rxBuffer[SUNRX_BUFFER_SIZE];
+// when the start bit came and when the stop bit was sampled, for latency.c
+static volatile uint16_t rxEdgeBuffer[SUNRX_BUFFER_SIZE];
+static volatile uint16_t rxDoneBuffer[SUNRX_BUFFER_SIZE];
+static volatile uint8_t rxHead;
+static volatile uint8_t rxTail;
+static uint8_t rxState;
+static uint8_t rxShift;
+static uint16_t rxEdge;
+static uint16_t rxLastPoll;
+static uint16_t rxDeadline;
+
+volatile uint8_t sunRxOverflows;
+volatile uint8_t sunRxFramingErrors;
+volatile uint16_t sunRxSampleLateness[SUNRX_SAMPLES];
+volatile uint16_t sunRxMaxLateness;
+uint16_t sunRxEdge;
+uint16_t sunRxDone;
+
+void sunRxInit(void) {
+	rxState = SUNRX_IDLE;
+	rxLastPoll = clockTicks();
+	rxDeadline = rxLastPoll + SUNRX_POLL_TICKS;
+	clockSetCompareA(rxDeadline);
+	TIFR = (1 << OCF1A);
+	TIMSK |= (1 << OCIE1A);
+}
+
+uint8_t sunRxAvailable(void) {
+	return rxHead != rxTail;
+}
+
+/* only call when sunRxAvailable() said so */
+uint8_t sunRxGet(void) {
+	uint8_t data = rxBuffer[rxTail];
+	sunRxEdge = rxEdgeBuffer[rxTail];
+	sunRxDone = rxDoneBuffer[rxTail];
+	rxTail = (rxTail + 1) & SUNRX_BUFFER_MASK;
+	return data;
+}
+
+static void rxPut(uint8_t data, uint16_t done) {
+	uint8_t next = (rxHead + 1) & SUNRX_BUFFER_MASK;
+
+	if (next == rxTail) {
+		sunRxOverflows++;
+		return;
+	}
+	rxBuffer[rxHead] = data;
+	rxEdgeBuffer[rxHead] = rxEdge;
+	rxDoneBuffer[rxHead] = done;
+	rxHead = next;
+}
+
+// interrupts stay enabled in here, V-USB needs INT0 to be served right away
+ISR(TIMER1_COMPA_vect, ISR_NOBLOCK) {
+	uint16_t now = clockTicks();
+	uint8_t lineActive = sunRxLineActive();
+	uint16_t lateness;
+
+	if (rxState == SUNRX_IDLE) {
+		if (lineActive) {
+			// the edge came somewhere since the last poll, assume halfway
+			rxEdge = rxLastPoll + ((uint16_t)(now - rxLastPoll) >> 1);
+			rxState = SUNRX_START;
+			rxDeadline = rxEdge + SUNRX_HALF_TICKS;
+		} else {
+			// no drift to care about while idle, so poll relative to now
+			rxLastPoll = now;
+			rxDeadline = now + SUNRX_POLL_TICKS;
+		}
+		clockSetCompareA(rxDeadline);
+		return;
+	}
+
+	lateness = now - rxDeadline;
+	sunRxSampleLateness[rxState - SUNRX_START] = lateness;
+	if (lateness > sunRxMaxLateness)
+		sunRxMaxLateness = lateness;
+
+	if (rxState == SUNRX_STOP) {
+		if (lineActive) {
+			sunRxFramingErrors++;
+			traceEvent(TRACE_ERROR, TRACE_RX, DIAG_TRACE_FRAMING, rxShift);
+		} else
+			rxPut(rxShift, now);
+		// a new start bit may follow right after this stop bit, poll from
+		// now: a late interrupt may already be past rxDeadline + SUNRX_POLL_TICKS
+		rxState = SUNRX_IDLE;
+		rxLastPoll = now;
+		rxDeadline = now + SUNRX_POLL_TICKS;
+		clockSetCompareA(rxDeadline);
+		return;
+	}
+
+	if (rxState == SUNRX_START) {
+		if (!lineActive) {
+			// just a glitch
+			traceEvent(TRACE_DEBUG, TRACE_RX, DIAG_TRACE_GLITCH, 0);
+			rxState = SUNRX_IDLE;
+			rxLastPoll = now;
+			rxDeadline = now + SUNRX_POLL_TICKS;
+			clockSetCompareA(rxDeadline);
+			return;
+		}
+	} else {
+		// lsb first and inverted, so a low line is a one
+		rxShift >>= 1;
+		if (!lineActive)
+			rxShift |= 0x80;
+	}
+
+	// every deadline is counted from the start bit edge, never from the
+	// previous sample, so a late interrupt does not move the ones after it
+	rxDeadline = rxEdge + SUNRX_HALF_TICKS + rxState * SUNRX_BIT_TICKS;
+	clockSetCompareA(rxDeadline);
+	rxState++;
+}
@@ -0,0 +1,59 @@
+/*
+ * sunRx.h - part of USBaspSunType5c
+ *
+ * Description....: Interrupt driven receiver for the Sun keyboard line
+ * Licence........: GNU GPL v3 (see LICENSE)
+ */
+
+#ifndef __sunrx_h_included__
+#define __sunrx_h_included__
+
+#include <stdint.h>
+
+/* the keyboard line is read on PB4, inverted: high is a space (start bit, 0) */
+#define SUNRX_PIN           PINB
+#define SUNRX_BIT           PB4
+#define sunRxLineActive()   (SUNRX_PIN & (1 << SUNRX_BIT))
+
+/* 1200 baud in timer 1 ticks, see clockInit() */
+#define SUNRX_BIT_TICKS     1250
+#define SUNRX_HALF_TICKS    625
+/* the idle line is polled 8 times per bit to find the start bit */
+#define SUNRX_POLL_TICKS    156
+
+/* responses of the keyboard that are not key codes */
+#define SUN_RESP_IDLE       0x7f
+#define SUN_RESP_ERROR      0x7e
+#define SUN_RESP_LAYOUT     0xfe
+#define SUN_RESP_RESET      0xff
+
+/* received bytes waiting for the main loop, must be a power of two */
+#define SUNRX_BUFFER_SIZE   16
+
+/* receiver states, data bits use the states in between */
+#define SUNRX_IDLE          0
+#define SUNRX_START         1
+#define SUNRX_STOP          10
+/* start bit, 8 data bits and stop bit are sampled */
+#define SUNRX_SAMPLES       10
+
+/* bytes lost because the main loop did not drain the buffer in time */
+extern volatile uint8_t sunRxOverflows;
+/* bytes dropped because the stop bit was missing */
+extern volatile uint8_t sunRxFramingErrors;
+/* how late each sample of the last frame was taken after its deadline and the
+ * worst case so far, in timer 1 ticks. The deadlines themselves are within
+ * half a poll interval of the true bit middles. Read with interrupts off. */
+extern volatile uint16_t sunRxSampleLateness[SUNRX_SAMPLES];
+extern volatile uint16_t sunRxMaxLateness;
+
+/* timer 1 values of the start bit edge and the stop bit sample of the byte
+ * sunRxGet() returned last */
+extern uint16_t sunRxEdge;
+extern uint16_t sunRxDone;
+
+void sunRxInit(void);
+uint8_t sunRxAvailable(void);
+uint8_t sunRxGet(void);
+
+#endif /* __sunrx_h_included__ */
@@ -0,0 +1,116 @@
+/*
+ * sunTx.c - part of USBaspSunType5c
+ *
+ * Description....: Interrupt driven, queued transmitter to the Sun keyboard
+ * Licence........: GNU GPL v3 (see LICENSE)
+ *
+ * Timer 1 compare B clocks out one bit per interrupt, so a command costs a
+ * few dozen cycles every 833 us instead of blocking with interrupts off for
+ * a whole frame. Commands wait in per kind slots: queueing the LED state ten
+ * times before the line is free still only sends the latest one.
+ */
+
+#include <inttypes.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "clock.h"
+#include "sunTx.h"
+#include "trace.h"
+
+/* time from queueing into an idle transmitter until the start bit */
+#define SUNTX_KICK_TICKS    16
+
+static volatile uint8_t txPending;
+static volatile uint8_t txCommand[SUNTX_SLOTS];
+static volatile uint8_t txLeds;
+static uint16_t txDeadline;
+static uint8_t txState;
+static uint8_t txByte;
+static uint8_t txNext;
+static uint8_t txHasNext;
+
+static void txKick(uint8_t slot) {
+	uint8_t sreg = SREG;
+
+	cli();
+	criticalStart();
+	txPending |= (1 << slot);
+	if (!(TIMSK & (1 << OCIE1B))) {
+		txDeadline = TIMER1VALUE + SUNTX_KICK_TICKS;
+		OCR1B = txDeadline;
+		TIFR = (1 << OCF1B);
+		TIMSK |= (1 << OCIE1B);
+	}
+	criticalStop();
+	SREG = sreg;
+	criticalEnd(CRITICAL_TX_KICK);
+}
+
+void sunTxCommand(uint8_t slot, uint8_t command) {
+	txCommand[slot] = command;
+	txKick(slot);
+}
+
+void sunTxLeds(uint8_t leds) {
+	// only read when the frame starts, so the last value written wins
+	txLeds = leds;
+	txKick(SUNTX_SLOT_LED);
+}
+
+uint8_t sunTxBusy(void) {
+	return TIMSK & (1 << OCIE1B);
+}
+
+// fetch the next byte to send, returns 0 when there is nothing left
+static uint8_t txLoad(void) {
+	uint8_t slot;
+
+	if (txHasNext) {
+		txHasNext = 0;
+		txByte = txNext;
+		return 1;
+	}
+	for (slot = 0; slot < SUNTX_SLOTS; slot++) {
+		if (txPending & (1 << slot)) {
+			txPending &= ~(1 << slot);
+			if (slot == SUNTX_SLOT_LED) {
+				txByte = SUN_CMD_SET_LED;
+				txNext = txLeds;
+				txHasNext = 1;
+			} else {
+				txByte = txCommand[slot];
+			}
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// interrupts stay enabled in here, V-USB needs INT0 to be served right away
+ISR(TIMER1_COMPB_vect, ISR_NOBLOCK) {
+	txDeadline += SUNTX_BIT_TICKS;
+	clockSetCompareB(txDeadline);
+
+	if (txState == SUNTX_IDLE) {
+		if (!txLoad()) {
+			TIMSK &= ~(1 << OCIE1B);
+			return;
+		}
+		sunTxSpace();
+		traceEvent(TRACE_DEBUG, TRACE_TX, DIAG_TRACE_COMMAND, txByte);
+	} else if (txState < SUNTX_STOP) {
+		// the keyboard wants its data inverted and lsb first
+		if (txByte & 0x01)
+			sunTxMark();
+		else
+			sunTxSpace();
+		txByte >>= 1;
+	} else if (txState == SUNTX_STOP) {
+		sunTxMark();
+	} else {
+		// one more idle bit before the next frame
+		txState = SUNTX_IDLE;
+		return;
+	}
+	txState++;
+}
@@ -0,0 +1,49 @@
+/*
+ * sunTx.h - part of USBaspSunType5c
+ *
+ * Description....: Interrupt driven, queued transmitter to the Sun keyboard
+ * Licence........: GNU GPL v3 (see LICENSE)
+ */
+
+#ifndef __suntx_h_included__
+#define __suntx_h_included__
+
+#include <stdint.h>
+
+/* the keyboard line is driven on PB3, inverted: high is a space (start bit, 0) */
+#define SUNTX_PORT          PORTB
+#define SUNTX_BIT           PB3
+#define sunTxSpace()        SUNTX_PORT |= (1 << SUNTX_BIT)
+#define sunTxMark()         SUNTX_PORT &= ~(1 << SUNTX_BIT)
+
+/* 1200 baud in timer 1 ticks, see clockInit() */
+#define SUNTX_BIT_TICKS     1250
+
+/* commands understood by the keyboard */
+#define SUN_CMD_RESET       0x01
+#define SUN_CMD_BELL_ON     0x02
+#define SUN_CMD_BELL_OFF    0x03
+#define SUN_CMD_CLICK_ON    0x0a
+#define SUN_CMD_CLICK_OFF   0x0b
+#define SUN_CMD_SET_LED     0x0e
+#define SUN_CMD_LAYOUT      0x0f
+
+/* every kind of command has one slot, a newer command replaces a queued one
+ * of the same kind. Lower slots are sent first. */
+#define SUNTX_SLOT_RESET    0
+#define SUNTX_SLOT_BELL     1
+#define SUNTX_SLOT_CLICK    2
+#define SUNTX_SLOT_LED      3
+#define SUNTX_SLOT_LAYOUT   4
+#define SUNTX_SLOTS         5
+
+/* transmitter states, data bits use the states in between */
+#define SUNTX_IDLE          0
+#define SUNTX_STOP          9
+#define SUNTX_GAP           10
+
+void sunTxCommand(uint8_t slot, uint8_t command);
+void sunTxLeds(uint8_t leds);
+uint8_t sunTxBusy(void);
+
+#endif /* __suntx_h_included__ */
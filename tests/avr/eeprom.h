@@ -0,0 +1,19 @@
+/*
+ * eeprom.h - part of USBaspSunType5c
+ *
+ * Description....: EEPROM access for the host tests, EEMEM is just RAM there
+ * Licence........: GNU GPL v3 (see LICENSE)
+ */
+
+#ifndef __stub_eeprom_h_included__
+#define __stub_eeprom_h_included__
+
+#include <stdint.h>
+#include <string.h>
+
+#define EEMEM
+#define eeprom_read_byte(p)             (*(const uint8_t *)(p))
+#define eeprom_update_byte(p, value)    (*(uint8_t *)(p) = (value))
+#define eeprom_read_block(dst, src, n)  memcpy((dst), (src), (n))
+
+#endif /* __stub_eeprom_h_included__ */
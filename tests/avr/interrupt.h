@@ -0,0 +1,20 @@
+/*
+ * interrupt.h - part of USBaspSunType5c
+ *
+ * Description....: Interrupt macros for the host tests
+ * Licence........: GNU GPL v3 (see LICENSE)
+ *
+ * An ISR becomes a plain function the test calls when its timer would fire.
+ */
+
+#ifndef __stub_interrupt_h_included__
+#define __stub_interrupt_h_included__
+
+#include "io.h"
+
+#define cli()
+#define sei()
+#define ISR_NOBLOCK
+#define ISR(vector, ...)    void vector(void); void vector(void)
+
+#endif /* __stub_interrupt_h_included__ */
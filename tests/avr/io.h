@@ -0,0 +1,34 @@
+/*
+ * io.h - part of USBaspSunType5c
+ *
+ * Description....: Registers as plain variables for the host tests
+ * Licence........: GNU GPL v3 (see LICENSE)
+ *
+ * Only what the modules under test touch. The tests drive the timer and
+ * pin variables themselves, see avrStub.c.
+ */
+
+#ifndef __stub_io_h_included__
+#define __stub_io_h_included__
+
+#include <stdint.h>
+
+extern volatile uint8_t PORTB, PORTC, PORTD, PINB, PINC, PIND, DDRB, DDRC, DDRD;
+extern volatile uint8_t SREG, MCUCR, GICR, GIFR, TIMSK, TIFR, TCCR0, TCCR1B, TCNT0;
+extern volatile uint16_t TCNT1, OCR1A, OCR1B;
+
+#define PB3     3
+#define PB4     4
+#define PB5     5
+#define PC0     0
+#define PC1     1
+#define PC2     2
+#define CS00    0
+#define CS01    1
+#define CS11    1
+#define OCIE1A  4
+#define OCIE1B  3
+#define OCF1A   4
+#define OCF1B   3
+
+#endif /* __stub_io_h_included__ */
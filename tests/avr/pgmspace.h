@@ -0,0 +1,22 @@
+/*
+ * pgmspace.h - part of USBaspSunType5c
+ *
+ * Description....: Flash access for the host tests, flash is just RAM there
+ * Licence........: GNU GPL v3 (see LICENSE)
+ */
+
+#ifndef __stub_pgmspace_h_included__
+#define __stub_pgmspace_h_included__
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s)             (s)
+#define pgm_read_byte(p)    (*(const uint8_t *)(p))
+#define pgm_read_word(p)    (*(const uint16_t *)(p))
+#define pgm_read_dword(p)   (*(const uint32_t *)(p))
+#define pgm_read_ptr(p)     (*(void * const *)(p))
+#define memcpy_P            memcpy
+
+#endif /* __stub_pgmspace_h_included__ */
@@ -0,0 +1,12 @@
+/*
+ * avrStub.c - part of USBaspSunType5c
+ *
+ * Description....: Registers as plain variables for the host tests
+ * Licence........: GNU GPL v3 (see LICENSE)
+ */
+
+#include <avr/io.h>
+
+volatile uint8_t PORTB, PORTC, PORTD, PINB, PINC, PIND, DDRB, DDRC, DDRD;
+volatile uint8_t SREG, MCUCR, GICR, GIFR, TIMSK, TIFR, TCCR0, TCCR1B, TCNT0;
+volatile uint16_t TCNT1, OCR1A, OCR1B;
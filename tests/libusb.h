@@ -0,0 +1,32 @@
+/*
+ * libusb.h - part of USBaspSunType5c
+ *
+ * Description....: The few libusb-1.0 calls of sundiag for the host tests
+ * Licence........: GNU GPL v3 (see LICENSE)
+ *
+ * testDiag.c implements them on top of diag.c instead of a real device.
+ */
+
+#ifndef __stub_libusb_h_included__
+#define __stub_libusb_h_included__
+
+#include <stdint.h>
+
+typedef struct libusb_context libusb_context;
+typedef struct libusb_device_handle libusb_device_handle;
+
+#define LIBUSB_ENDPOINT_IN          0x80
+#define LIBUSB_ENDPOINT_OUT         0x00
+#define LIBUSB_REQUEST_TYPE_VENDOR  (0x02 << 5)
+#define LIBUSB_RECIPIENT_DEVICE     0x00
+#define LIBUSB_ERROR_PIPE           (-9)
+
+int libusb_init(libusb_context **context);
+void libusb_exit(libusb_context *context);
+libusb_device_handle *libusb_open_device_with_vid_pid(libusb_context *context, uint16_t vid, uint16_t pid);
+void libusb_close(libusb_device_handle *handle);
+const char *libusb_strerror(int error);
+int libusb_control_transfer(libusb_device_handle *handle, uint8_t bmRequestType, uint8_t bRequest,
+		uint16_t wValue, uint16_t wIndex, unsigned char *data, uint16_t wLength, unsigned int timeout);
+
+#endif /* __stub_libusb_h_included__ */
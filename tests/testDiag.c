@@ -0,0 +1,227 @@
+/*
+ * testDiag.c - part of USBaspSunType5c
+ *
+ * Description....: Host test of sundiag against a simulated device
+ * Licence........: GNU GPL v3 (see LICENSE)
+ *
+ * sundiag.c is built with libusb_control_transfer() going straight into
+ * diagSetup() and diagRead() of the firmware, 8 bytes per packet like
+ * V-USB. Between two packets the simulated device goes on: keys are timed,
+ * the trace fills and counters move. Every block read must still be the
+ * state of the moment the request came in.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "diag.h"
+#include "main.h"
+#include "latency.h"
+#include "trace.h"
+
+#define main sundiagMain
+#include "../tools/sundiag.c"
+#undef main
+
+// what diag.c reads from the rest of the firmware
+volatile uint8_t sunRxOverflows;
+volatile uint8_t sunRxFramingErrors;
+volatile uint16_t sunRxMaxLateness;
+uint8_t sunKeyboardErrors;
+uint8_t sunLayout;
+uint8_t keymapEepromValid;
+uint8_t layerMask;
+uint8_t reportQueueOverflows;
+uint8_t keyStateRollovers;
+uint8_t hidLayout;
+uint8_t hidLayoutSetting;
+
+static uint16_t millis;
+static uint8_t traceData;
+
+// the block as it was when the setup packet came in
+static uint8_t expected[256];
+static int expectedLength;
+
+static int failures;
+
+static void check(int ok, const char *name, const char *what) {
+	if (!ok) {
+		printf("%s: %s\n", name, what);
+		failures++;
+	}
+}
+
+uint16_t clockMillis(void) {
+	return millis;
+}
+
+// the main loop and the interrupts between two packets
+static void deviceRuns(void) {
+	millis += 3;
+	sunRxOverflows++;
+	latencyRecord(LATENCY_BUILT, 0, 4000 + millis);
+	latencyRecord(LATENCY_TAKEN, 0, 20000 + millis);
+	traceEvent(TRACE_INFO, TRACE_KEYBOARD, DIAG_TRACE_KEYBOARD, ++traceData);
+}
+
+static void expectBlock(uint8_t request) {
+	switch (request) {
+	case DIAG_RQ_LATENCY:
+		memcpy(expected, &latencyStats, sizeof(latencyStats));
+		expectedLength = sizeof(latencyStats);
+		break;
+	default:
+		expectedLength = -1;
+	}
+}
+
+int libusb_init(libusb_context **context) {
+	return 0;
+}
+
+void libusb_exit(libusb_context *context) {
+}
+
+libusb_device_handle *libusb_open_device_with_vid_pid(libusb_context *context, uint16_t vid, uint16_t pid) {
+	return 0;
+}
+
+void libusb_close(libusb_device_handle *handle) {
+}
+
+const char *libusb_strerror(int error) {
+	return "pipe error";
+}
+
+int libusb_control_transfer(libusb_device_handle *handle, uint8_t bmRequestType, uint8_t bRequest,
+		uint16_t wValue, uint16_t wIndex, unsigned char *data, uint16_t wLength, unsigned int timeout) {
+	usbRequest_t rq;
+	usbMsgLen_t result;
+	uint8_t packet;
+	int got = 0;
+
+	rq.bmRequestType = bmRequestType;
+	rq.bRequest = bRequest;
+	rq.wValue.word = wValue;
+	rq.wIndex.word = wIndex;
+	rq.wLength.word = wLength;
+	expectBlock(bRequest);
+	result = diagSetup(&rq, HID_PROTOCOL_REPORT, 125);
+	if (!(bmRequestType & LIBUSB_ENDPOINT_IN))
+		return 0;
+	if (result != USB_NO_MSG)
+		return LIBUSB_ERROR_PIPE;
+	// a short packet ends the data stage
+	do {
+		deviceRuns();
+		packet = diagRead(data + got, wLength - got < 8 ? wLength - got : 8);
+		got += packet;
+	} while (packet == 8 && got < wLength);
+	return got;
+}
+
+static void testLatency(void) {
+	latencyStats_t stats;
+	uint16_t decoded = 0;
+	uint8_t i;
+
+	for (i = 0; i < 20; i++)
+		latencyRecord(LATENCY_DECODED, 0, 11000 + 100 * i);
+	check(readBlock(DIAG_RQ_LATENCY, &stats, sizeof(stats)) == sizeof(stats), "latency", "short read");
+	check(expectedLength == sizeof(stats), "latency", "no snapshot expected");
+	check(!memcmp(&stats, expected, sizeof(stats)), "latency", "packets from different moments");
+	check(memcmp(&stats, &latencyStats, sizeof(stats)) != 0, "latency", "device did not change it during the read");
+	for (i = 0; i < LATENCY_BUCKETS; i++)
+		decoded += stats.count[LATENCY_DECODED][i];
+	check(decoded == 20, "latency", "decoded samples missing");
+}
+
+// an NKRO report taken 90 ms after its start bit, timer 1 wrapped twice
+static void testLongLatency(void) {
+	latencyStats_t stats;
+	uint16_t edge = 1000;
+	uint16_t edgeMillis;
+
+	latencyClear();
+	TCNT1 = edge + 12 * LATENCY_TICKS_PER_MS;
+	millis += 12;
+	edgeMillis = latencyEdgeMillis(edge);
+	millis += 78;
+	latencyRecordLong(LATENCY_TAKEN, edge, edgeMillis, edge + (uint16_t) (90UL * LATENCY_TICKS_PER_MS));
+	check(readBlock(DIAG_RQ_LATENCY, &stats, sizeof(stats)) == sizeof(stats), "long latency", "short read");
+	check(stats.max[LATENCY_TAKEN] == 90UL * LATENCY_TICKS_PER_MS, "long latency", "wrong maximum");
+	check(stats.count[LATENCY_TAKEN][LATENCY_BUCKETS - 1] == 1, "long latency", "not in the last bucket");
+}
+
+// 16 entries are 64 bytes, 8 packets with new entries coming in between
+static void testTrace(void) {
+	diagTraceEntry_t trace[DIAG_TRACE_SIZE];
+	uint8_t first, i;
+
+	for (i = 0; i < DIAG_TRACE_SIZE + 4; i++)
+		traceEvent(TRACE_INFO, TRACE_KEYBOARD, DIAG_TRACE_KEYBOARD, ++traceData);
+	first = traceData - DIAG_TRACE_SIZE + 1;
+	check(readBlock(DIAG_RQ_TRACE, trace, sizeof(trace)) == sizeof(trace), "trace", "short read");
+	for (i = 0; i < DIAG_TRACE_SIZE; i++) {
+		check(trace[i].event == DIAG_TRACE_KEYBOARD, "trace", "wrong event");
+		check(trace[i].data == (uint8_t) (first + i), "trace", "entries missing, repeated or out of order");
+	}
+}
+
+static void testCounters(void) {
+	diagCounters_t counters;
+	uint8_t overflows;
+
+	sunRxOverflows = 40;
+	sunKeyboardErrors = 2;
+	overflows = sunRxOverflows;
+	check(readBlock(DIAG_RQ_COUNTERS, &counters, sizeof(counters)) == sizeof(counters), "counters", "short read");
+	check(counters.version == DIAG_VERSION, "counters", "wrong version");
+	// the device ran before the first packet, but after the setup
+	check(counters.rxOverflows == overflows, "counters", "not the value of the request");
+	check(counters.keyboardErrors == 2, "counters", "wrong keyboard errors");
+}
+
+static void testConfig(void) {
+	diagConfig_t config;
+
+	hidLayout = 2;
+	layerMask = 0x01;
+	check(readBlock(DIAG_RQ_CONFIG, &config, sizeof(config)) == sizeof(config), "config", "short read");
+	check(config.version == DIAG_VERSION, "config", "wrong version");
+	check(config.hidLayout == 2 && config.layerMask == 0x01, "config", "wrong values");
+	check(config.protocol == HID_PROTOCOL_REPORT && config.idleRate == 125, "config", "wrong protocol or idle rate");
+	check(checkFirmware() == 0, "config", "version of the firmware refused");
+}
+
+static void testClearAndLayout(void) {
+	latencyStats_t stats;
+	latencyStats_t zero;
+
+	check(request(DIAG_RQ_CLEAR, 0) == 0, "clear", "request failed");
+	check(sunRxOverflows == 0 && sunKeyboardErrors == 0, "clear", "counters left");
+	memset(&zero, 0, sizeof(zero));
+	check(readBlock(DIAG_RQ_LATENCY, &stats, sizeof(stats)) == sizeof(stats), "clear", "short read");
+	check(!memcmp(&stats, &zero, sizeof(stats)), "clear", "latency left");
+
+	hidLayoutSetting = 0;
+	check(request(DIAG_RQ_SET_LAYOUT, 1) == 0, "layout", "request failed");
+	check(hidLayoutSetting == 1, "layout", "not stored");
+	request(DIAG_RQ_SET_LAYOUT, 7);
+	check(hidLayoutSetting == 1, "layout", "bad layout stored");
+}
+
+int main(void) {
+	testLatency();
+	testLongLatency();
+	testTrace();
+	testCounters();
+	testConfig();
+	testClearAndLayout();
+	if (failures)
+		printf("testDiag: %d failed\n", failures);
+	else
+		printf("testDiag: all passed\n");
+	return failures != 0;
+}
@@ -0,0 +1,198 @@
+/*
+ * testReportQueue.c - part of USBaspSunType5c
+ *
+ * Description....: Host test of the report queue with a fast typing burst
+ * Licence........: GNU GPL v3 (see LICENSE)
+ *
+ * Plays the main loop and the host: keyboard, consumer and system reports
+ * change faster than the host polls, the host takes one snapshot per poll
+ * and keeps the last one of each report ID. Whatever got dropped on the
+ * way, the host has to end up with the latest state of every report.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "keyState.h"
+#include "reportQueue.h"
+
+// the latest states, as main.c keeps them, in the composite layout
+static uint8_t keyboardState[9] = { REPORT_ID_KEYBOARD };
+static uint8_t consumerState[3] = { REPORT_ID_CONSUMER };
+static uint8_t systemState[2] = { REPORT_ID_SYSTEM };
+
+// what the host made of the snapshots it got
+static uint8_t hostKeyboard[sizeof(keyboardState)];
+static uint8_t hostConsumer[sizeof(consumerState)];
+static uint8_t hostSystem[sizeof(systemState)];
+static uint8_t lastKey;
+static uint8_t keysInOrder;
+
+static int failures;
+
+static void check(int ok, const char *name, const char *what) {
+	if (!ok) {
+		printf("%s: %s\n", name, what);
+		failures++;
+	}
+}
+
+static void reset(void) {
+	reportQueueClear();
+	reportQueueOverflows = 0;
+	memset(keyboardState + 1, 0, sizeof(keyboardState) - 1);
+	memset(consumerState + 1, 0, sizeof(consumerState) - 1);
+	memset(systemState + 1, 0, sizeof(systemState) - 1);
+	memset(hostKeyboard, 0, sizeof(hostKeyboard));
+	memset(hostConsumer, 0, sizeof(hostConsumer));
+	memset(hostSystem, 0, sizeof(hostSystem));
+	// the host starts out with nothing held
+	hostKeyboard[0] = REPORT_ID_KEYBOARD;
+	hostConsumer[0] = REPORT_ID_CONSUMER;
+	hostSystem[0] = REPORT_ID_SYSTEM;
+	lastKey = 0;
+	keysInOrder = 1;
+}
+
+// one interrupt transfer
+static void hostPoll(void) {
+	const uint8_t *data;
+	uint8_t length;
+
+	if (reportQueueEmpty())
+		return;
+	data = reportQueuePeek(&length);
+	switch (data[0]) {
+	case REPORT_ID_KEYBOARD:
+		check(length == sizeof(keyboardState), "poll", "keyboard report length");
+		memcpy(hostKeyboard, data, sizeof(hostKeyboard));
+		// key codes only go up in the bursts below, older snapshots must not overtake newer ones
+		if (data[3] && data[3] < lastKey)
+			keysInOrder = 0;
+		if (data[3])
+			lastKey = data[3];
+		break;
+	case REPORT_ID_CONSUMER:
+		check(length == sizeof(consumerState), "poll", "consumer report length");
+		memcpy(hostConsumer, data, sizeof(hostConsumer));
+		break;
+	case REPORT_ID_SYSTEM:
+		check(length == sizeof(systemState), "poll", "system report length");
+		memcpy(hostSystem, data, sizeof(hostSystem));
+		break;
+	default:
+		check(0, "poll", "unknown report ID");
+	}
+	reportQueuePop();
+}
+
+static void pushKeyboard(uint8_t key) {
+	keyboardState[3] = key;
+	reportQueuePush(REPORT_ID_KEYBOARD, keyboardState, sizeof(keyboardState));
+}
+
+static void pushConsumer(uint16_t usage) {
+	consumerState[1] = usage;
+	consumerState[2] = usage >> 8;
+	reportQueuePush(REPORT_ID_CONSUMER, consumerState, sizeof(consumerState));
+}
+
+static void pushSystem(uint8_t usage) {
+	systemState[1] = usage;
+	reportQueuePush(REPORT_ID_SYSTEM, systemState, sizeof(systemState));
+}
+
+static void expectFinal(const char *name) {
+	uint8_t polls;
+
+	for (polls = 0; polls < 2 * REPORTQUEUE_SIZE && !reportQueueEmpty(); polls++)
+		hostPoll();
+	check(reportQueueEmpty(), name, "queue does not drain");
+	check(!memcmp(hostKeyboard, keyboardState, sizeof(keyboardState)), name, "host keyboard state is stale");
+	check(!memcmp(hostConsumer, consumerState, sizeof(consumerState)), name, "host consumer state is stale");
+	check(!memcmp(hostSystem, systemState, sizeof(systemState)), name, "host system state is stale");
+	check(keysInOrder, name, "keyboard snapshots out of order");
+}
+
+// the case that used to leave a media key held: the queue fills up with
+// keyboard snapshots, then volume up goes down and up again
+static void testConsumerReleaseBehindKeys(void) {
+	uint8_t i;
+
+	reset();
+	for (i = 0; i < 3 * REPORTQUEUE_SIZE; i++) {
+		pushKeyboard(0x04 + i);
+		pushKeyboard(0);
+	}
+	pushConsumer(0xe9);
+	pushConsumer(0);
+	pushSystem(0x81);
+	pushSystem(0);
+	check(reportQueueOverflows > 0, "release behind keys", "queue never overflowed");
+	expectFinal("release behind keys");
+}
+
+// a media key still held at the end of the burst must reach the host held
+static void testConsumerHeldAtEnd(void) {
+	uint8_t i;
+
+	reset();
+	for (i = 0; i < 2 * REPORTQUEUE_SIZE; i++)
+		pushKeyboard(0x04 + i);
+	pushConsumer(0xea);
+	pushKeyboard(0x40);
+	expectFinal("held at end");
+	check(hostConsumer[1] == 0xea, "held at end", "volume down lost");
+}
+
+// all three kinds mixed, the host polling every third change
+static void testMixedBurst(void) {
+	uint8_t i;
+
+	reset();
+	for (i = 0; i < 60; i++) {
+		switch (i % 5) {
+		case 0:
+			pushKeyboard(0x04 + i);
+			break;
+		case 1:
+			pushConsumer(i & 0x02 ? 0xe2 : 0);
+			break;
+		case 2:
+			pushKeyboard(0);
+			break;
+		case 3:
+			pushSystem(i & 0x04 ? 0x82 : 0);
+			break;
+		default:
+			pushConsumer(0);
+		}
+		if (i % 3 == 0)
+			hostPoll();
+	}
+	check(reportQueueOverflows > 0, "mixed burst", "queue never overflowed");
+	expectFinal("mixed burst");
+}
+
+// nothing counts as lost when the burst fits
+static void testNoOverflow(void) {
+	reset();
+	pushKeyboard(0x04);
+	pushConsumer(0xcd);
+	pushKeyboard(0);
+	pushConsumer(0);
+	check(reportQueueOverflows == 0, "no overflow", "overflow counted");
+	expectFinal("no overflow");
+}
+
+int main(void) {
+	testConsumerReleaseBehindKeys();
+	testConsumerHeldAtEnd();
+	testMixedBurst();
+	testNoOverflow();
+	if (failures)
+		printf("testReportQueue: %d failed\n", failures);
+	else
+		printf("testReportQueue: all passed\n");
+	return failures != 0;
+}
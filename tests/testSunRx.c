@@ -0,0 +1,249 @@
+/*
+ * testSunRx.c - part of USBaspSunType5c
+ *
+ * Description....: Host test of the receiver state machine against waveforms
+ * Licence........: GNU GPL v3 (see LICENSE)
+ *
+ * The test plays the part of timer 1: it lets time run to the next compare
+ * match, optionally late like an interrupt held up by V-USB, sets the
+ * keyboard pin from a recorded waveform and calls the interrupt. The bytes
+ * and counters the receiver comes up with are checked against what was put
+ * on the line.
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <avr/io.h>
+#include "sunRx.h"
+
+void TIMER1_COMPA_vect(void);
+
+#define BIT         SUNRX_BIT_TICKS
+#define MAX_EDGES   256
+#define MAX_BYTES   32
+
+typedef struct {
+	uint32_t time;
+	uint8_t active;
+} edge_t;
+
+static edge_t edges[MAX_EDGES];
+static uint16_t edgeCount;
+static uint32_t lineEnd;
+
+static uint8_t received[MAX_BYTES];
+static uint8_t receivedCount;
+
+// interrupt latency: a fixed amount once at lateAt, or random up to jitter
+static uint32_t lateAt;
+static uint16_t lateTicks;
+static uint16_t jitter;
+static uint32_t seed;
+
+static int failures;
+
+static void check(int ok, const char *name, const char *what) {
+	if (!ok) {
+		printf("%s: %s\n", name, what);
+		failures++;
+	}
+}
+
+static void lineReset(void) {
+	edgeCount = 0;
+	lineEnd = 0;
+	lateAt = 0;
+	lateTicks = 0;
+	jitter = 0;
+}
+
+// keep the line at one level for a while
+static void lineHold(uint8_t active, uint32_t ticks) {
+	if (edgeCount < MAX_EDGES) {
+		edges[edgeCount].time = lineEnd;
+		edges[edgeCount].active = active;
+		edgeCount++;
+	}
+	lineEnd += ticks;
+}
+
+// start bit, data lsb first and inverted (a one is a low line), stop bit
+static void lineByte(uint8_t data, uint16_t bit, uint8_t stopActive) {
+	uint8_t i;
+
+	lineHold(1, bit);
+	for (i = 0; i < 8; i++)
+		lineHold(!(data & (1 << i)), bit);
+	lineHold(stopActive, bit);
+}
+
+static uint8_t lineAt(uint32_t time) {
+	uint8_t active = 0;
+	uint16_t i;
+
+	for (i = 0; i < edgeCount && edges[i].time <= time; i++)
+		active = edges[i].active;
+	return active;
+}
+
+static uint16_t latency(uint32_t match) {
+	uint16_t late = lateTicks;
+
+	if (late && match >= lateAt) {
+		lateTicks = 0;
+		return late;
+	}
+	if (jitter) {
+		seed = seed * 1103515245 + 12345;
+		return (seed >> 16) % (jitter + 1);
+	}
+	return 0;
+}
+
+static void run(void) {
+	uint32_t now = 0;
+	uint16_t wait;
+	uint16_t late;
+
+	receivedCount = 0;
+	sunRxOverflows = 0;
+	sunRxFramingErrors = 0;
+	sunRxMaxLateness = 0;
+	TCNT1 = 0;
+	PINB = 0;
+	sunRxInit();
+	while (now < lineEnd + 2 * BIT) {
+		// the match only happens when the counter gets to OCR1A, a compare
+		// value already behind it waits for the next round
+		wait = OCR1A - (uint16_t) now;
+		now += wait ? wait : 0x10000;
+		late = latency(now);
+		now += late;
+		TCNT1 = now;
+		PINB = lineAt(now) ? (1 << PB4) : 0;
+		TIMER1_COMPA_vect();
+		while (sunRxAvailable() && receivedCount < MAX_BYTES)
+			received[receivedCount++] = sunRxGet();
+	}
+}
+
+static void expect(const char *name, const uint8_t *bytes, uint8_t count, uint8_t framingErrors) {
+	uint8_t i;
+
+	check(receivedCount == count, name, "wrong number of bytes");
+	for (i = 0; i < count && i < receivedCount; i++)
+		check(received[i] == bytes[i], name, "wrong byte");
+	check(sunRxFramingErrors == framingErrors, name, "wrong framing error count");
+	check(sunRxOverflows == 0, name, "buffer overflow");
+}
+
+static const uint8_t pattern[] = { 0x00, 0xff, 0x55, 0xaa, 0x7f, 0x01, 0x80, 0xfe };
+
+static void sendPattern(uint16_t bit) {
+	uint8_t i;
+
+	lineHold(0, 3 * BIT);
+	// back to back, every start bit right after the previous stop bit
+	for (i = 0; i < sizeof(pattern); i++)
+		lineByte(pattern[i], bit, 0);
+}
+
+static void testNominal(void) {
+	lineReset();
+	sendPattern(BIT);
+	run();
+	expect("nominal", pattern, sizeof(pattern), 0);
+}
+
+// the keyboard's clock may be a few percent off
+static void testBaudError(void) {
+	lineReset();
+	sendPattern(BIT * 102 / 100);
+	run();
+	expect("2% slow", pattern, sizeof(pattern), 0);
+
+	lineReset();
+	sendPattern(BIT * 98 / 100);
+	run();
+	expect("2% fast", pattern, sizeof(pattern), 0);
+}
+
+// every sample up to 100 us late, as with USB traffic going on
+static void testJitter(void) {
+	lineReset();
+	sendPattern(BIT);
+	jitter = 150;
+	seed = 1;
+	run();
+	expect("jitter", pattern, sizeof(pattern), 0);
+
+	lineReset();
+	sendPattern(BIT * 102 / 100);
+	jitter = 150;
+	seed = 7;
+	run();
+	expect("jitter 2% slow", pattern, sizeof(pattern), 0);
+}
+
+// the stop bit sample of the first byte 200 us late, the next start bit
+// follows right after the stop bit
+static void testLateStop(void) {
+	lineReset();
+	sendPattern(BIT);
+	lateAt = 3 * BIT + 9 * BIT;
+	lateTicks = 300;
+	run();
+	expect("late stop bit", pattern, sizeof(pattern), 0);
+	check(sunRxMaxLateness >= 300, "late stop bit", "lateness not recorded");
+}
+
+// one data sample 330 us late must not move the ones after it
+static void testLateData(void) {
+	lineReset();
+	sendPattern(BIT);
+	lateAt = 3 * BIT + 3 * BIT;
+	lateTicks = 500;
+	run();
+	expect("late data bit", pattern, sizeof(pattern), 0);
+}
+
+// a pulse shorter than half a bit is no start bit
+static void testGlitch(void) {
+	static const uint8_t after[] = { 0x42 };
+
+	lineReset();
+	lineHold(0, 3 * BIT);
+	lineHold(1, 200);
+	lineHold(0, 3 * BIT);
+	lineByte(0x42, BIT, 0);
+	run();
+	expect("glitch", after, sizeof(after), 0);
+}
+
+// a byte without stop bit is dropped and counted, the next one still arrives
+static void testFraming(void) {
+	static const uint8_t after[] = { 0x42 };
+
+	lineReset();
+	lineHold(0, 3 * BIT);
+	lineByte(0xff, BIT, 1);
+	lineHold(0, 3 * BIT);
+	lineByte(0x42, BIT, 0);
+	run();
+	expect("framing error", after, sizeof(after), 1);
+}
+
+int main(void) {
+	testNominal();
+	testBaudError();
+	testJitter();
+	testLateStop();
+	testLateData();
+	testGlitch();
+	testFraming();
+	if (failures)
+		printf("testSunRx: %d failed\n", failures);
+	else
+		printf("testSunRx: all passed\n");
+	return failures != 0;
+}
@@ -0,0 +1,136 @@
+/*
+ * keymapBench.c - part of USBaspSunType5c
+ *
+ * Description....: Cycles per scancode lookup, old map() against the table
+ * Licence........: GNU GPL v3 (see LICENSE)
+ *
+ * Run with "make keymapcycles", which takes map() from the first commit of
+ * the repository and runs this on an ATmega8 in simavr. Timer 1 counts CPU
+ * cycles around each call, the UART output is printed by simavr: minimum,
+ * mean and maximum over the 128 scancodes, less the cost of an empty call.
+ */
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
+#include "keycodes.h"
+#include "keymap.h"
+#include "hidDescriptor.h"
+
+uint8_t hidLayout; // hidDescriptor.c is not linked in
+
+// what map() used from main.c
+static uint8_t keyBoardHasReported = 2;
+static volatile uint8_t modifiers;
+static volatile uint8_t soundIsOn;
+
+static void toggleModifier(uint8_t key) {
+	modifiers ^= key;
+}
+
+static void toggleSound(void) {
+	soundIsOn = !soundIsOn;
+}
+
+#include "oldMap.h"
+
+static volatile uint16_t sink;
+
+static __attribute__((noinline)) void timeNothing(uint8_t code) {
+	sink = code;
+}
+
+static __attribute__((noinline)) void timeMap(uint8_t code) {
+	sink = map(code);
+}
+
+// the lookup of e01f659, one word from the flash table
+static __attribute__((noinline)) void timeTable(uint8_t code) {
+	sink = pgm_read_word(&keymapActive[code]);
+}
+
+static __attribute__((noinline)) void timeLookup(uint8_t code) {
+	sink = keymapLookup(code);
+}
+
+static void put(char c) {
+	while (!(UCSRA & (1 << UDRE))) {
+	}
+	UDR = c;
+}
+
+static void putString(const char *s) {
+	while (*s)
+		put(*s++);
+}
+
+static void putNumber(uint16_t n) {
+	char digits[6];
+	uint8_t i = 0;
+
+	do {
+		digits[i++] = '0' + n % 10;
+		n /= 10;
+	} while (n);
+	while (i)
+		put(digits[--i]);
+}
+
+static uint16_t cycles(void (*function)(uint8_t), uint8_t code) {
+	uint16_t start;
+
+	keyBoardHasReported = 2;
+	start = TCNT1;
+	function(code);
+	return TCNT1 - start;
+}
+
+static void measure(const char *name, void (*function)(uint8_t), uint16_t empty) {
+	uint16_t low = 0xffff;
+	uint16_t high = 0;
+	uint16_t sum = 0;
+	uint16_t taken;
+	uint8_t code;
+
+	for (code = 0; code < KEYMAP_SIZE; code++) {
+		taken = cycles(function, code) - empty;
+		if (taken < low)
+			low = taken;
+		if (taken > high)
+			high = taken;
+		sum += taken;
+	}
+	putString(name);
+	putString(": min ");
+	putNumber(low);
+	putString(" mean ");
+	putNumber((sum + KEYMAP_SIZE / 2) / KEYMAP_SIZE);
+	putString(" max ");
+	putNumber(high);
+	putString(" cycles\n");
+}
+
+int main(void) {
+	uint16_t empty;
+
+	TCCR1B = (1 << CS10);
+	UCSRB = (1 << TXEN);
+	empty = cycles(timeNothing, 0);
+
+	measure("map() switch", timeMap, empty);
+	measure("pgm_read_word", timeTable, empty);
+	// no EEPROM image in the simulator, so only the fallbacks are overrides
+	hidLayout = HID_LAYOUT_COMPOSITE;
+	keymapLoad();
+	measure("keymapLookup composite", timeLookup, empty);
+	hidLayout = HID_LAYOUT_BOOT;
+	keymapLoad();
+	measure("keymapLookup boot", timeLookup, empty);
+
+	// simavr stops on sleep with interrupts off
+	cli();
+	sleep_mode();
+	return 0;
+}
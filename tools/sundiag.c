@@ -0,0 +1,242 @@
+/*
+ * sundiag.c - part of USBaspSunType5c
+ *
+ * Description....: Host side of the diagnostics interface, see diagProtocol.h
+ * Licence........: GNU GPL v3 (see LICENSE)
+ *
+ * Build with "make sundiag" (needs libusb-1.0), then
+ *   sundiag counters | config | trace | latency | critical | loop | clear | layout <0|1|2>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libusb.h>
+#include "../diagProtocol.h"
+
+/* USB_CFG_VENDOR_ID and USB_CFG_DEVICE_ID of usbconfig.h */
+#define SUNDIAG_VID         0x4242
+#define SUNDIAG_PID         0xe131
+#define SUNDIAG_TIMEOUT_MS  1000
+
+static libusb_device_handle *device;
+
+/* the whole block in one transfer, split up it would mix two snapshots */
+static int readBlock(uint8_t request, void *buffer, int size) {
+	int got = libusb_control_transfer(device,
+			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+			request, 0, 0, buffer, size, SUNDIAG_TIMEOUT_MS);
+
+	if (got < 0) {
+		fprintf(stderr, "sundiag: %s\n", libusb_strerror(got));
+		return -1;
+	}
+	return got;
+}
+
+static int request(uint8_t request, uint16_t value) {
+	int result = libusb_control_transfer(device,
+			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+			request, value, 0, NULL, 0, SUNDIAG_TIMEOUT_MS);
+
+	if (result < 0) {
+		fprintf(stderr, "sundiag: %s\n", libusb_strerror(result));
+		return -1;
+	}
+	return 0;
+}
+
+static int checkVersion(uint8_t version) {
+	if (version != DIAG_VERSION) {
+		fprintf(stderr, "sundiag: firmware speaks version %u, this is %u\n", version, DIAG_VERSION);
+		return -1;
+	}
+	return 0;
+}
+
+/* the trace and the statistics blocks carry no version of their own, the
+ * config block tells which one the firmware speaks before they are decoded */
+static int checkFirmware(void) {
+	diagConfig_t config;
+
+	// the version comes first, whatever size the block has in that version
+	if (readBlock(DIAG_RQ_CONFIG, &config, sizeof(config)) < 1)
+		return -1;
+	return checkVersion(config.version);
+}
+
+static int showCounters(void) {
+	diagCounters_t counters;
+
+	if (readBlock(DIAG_RQ_COUNTERS, &counters, sizeof(counters)) != sizeof(counters)
+			|| checkVersion(counters.version))
+		return -1;
+	printf("uptime           %u ms (wraps at 65536)\n", counters.millis);
+	printf("rx overflows     %u\n", counters.rxOverflows);
+	printf("framing errors   %u\n", counters.rxFramingErrors);
+	printf("max rx lateness  %u ticks (%u us)\n", counters.rxMaxLateness, counters.rxMaxLateness * 2 / 3);
+	printf("keyboard errors  %u\n", counters.keyboardErrors);
+	printf("report overflows %u\n", counters.reportOverflows);
+	printf("rollovers        %u\n", counters.rollovers);
+	return 0;
+}
+
+static int showConfig(void) {
+	static const char *layouts[] = { "boot", "nkro", "composite" };
+	diagConfig_t config;
+
+	if (readBlock(DIAG_RQ_CONFIG, &config, sizeof(config)) != sizeof(config)
+			|| checkVersion(config.version))
+		return -1;
+	printf("report layout    %s\n", config.hidLayout < 3 ? layouts[config.hidLayout] : "?");
+	printf("protocol         %s\n", config.protocol ? "report" : "boot");
+	printf("idle rate        %u ms\n", config.idleRate * 4);
+	printf("keyboard layout  0x%02x\n", config.sunLayout);
+	printf("eeprom keymap    %s\n", config.keymapEepromValid ? "used" : "invalid");
+	printf("layers on        0x%02x\n", config.layerMask);
+	printf("ac keys          0x%04x\n", config.acKeys);
+	return 0;
+}
+
+static int showTrace(void) {
+	static const char *events[DIAG_TRACE_EVENTS] = { "", "keyboard", "usb reset", "protocol",
+			"unmapped", "framing", "glitch", "command", "bad id" };
+	diagTraceEntry_t trace[DIAG_TRACE_SIZE];
+	int size, i;
+
+	if (checkFirmware())
+		return -1;
+	size = readBlock(DIAG_RQ_TRACE, trace, sizeof(trace));
+	if (size == 0) {
+		printf("firmware built without tracing (KBD_TRACE_LEVEL=0)\n");
+		return 0;
+	}
+	if (size != sizeof(trace))
+		return -1;
+	for (i = 0; i < DIAG_TRACE_SIZE; i++) {
+		if (trace[i].event == DIAG_TRACE_NONE)
+			continue;
+		printf("%5u ms  %-10s 0x%02x\n", trace[i].millis,
+				trace[i].event < DIAG_TRACE_EVENTS ? events[trace[i].event] : "?", trace[i].data);
+	}
+	return 0;
+}
+
+#define SAME(ms) ms
+
+static int showLatency(void) {
+	static const char *stages[LATENCY_STAGES] = { "decoded", "built", "taken" };
+	static const int bounds[LATENCY_BUCKETS - 1] = { LATENCY_BOUNDS(SAME) };
+	latencyStats_t stats;
+	int stage, bucket;
+
+	if (checkFirmware() || readBlock(DIAG_RQ_LATENCY, &stats, sizeof(stats)) != sizeof(stats))
+		return -1;
+	printf("start bit to   ");
+	for (bucket = 0; bucket < LATENCY_BUCKETS - 1; bucket++)
+		printf(" <%2d ms", bounds[bucket]);
+	printf("  more     max\n");
+	for (stage = 0; stage < LATENCY_STAGES; stage++) {
+		printf("%-14s ", stages[stage]);
+		for (bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+			printf(" %6u", stats.count[stage][bucket]);
+		printf("  %5.2f ms\n", stats.max[stage] / 1500.0);
+	}
+	return 0;
+}
+
+static int showCritical(void) {
+	static const char *sites[CRITICAL_SITES] = {
+		"clockTicks", "compare A", "compare B", "tx kick", "diag", "millis"
+	};
+	criticalStats_t stats;
+	int site, got;
+
+	if (checkFirmware())
+		return -1;
+	got = readBlock(DIAG_RQ_CRITICAL, &stats, sizeof(stats));
+	if (got == 0) {
+		fprintf(stderr, "sundiag: firmware built without KBD_CRITICAL_STATS\n");
+		return -1;
+	}
+	if (got != sizeof(stats))
+		return -1;
+	printf("interrupts off   regions   max us  mean us\n");
+	for (site = 0; site < CRITICAL_SITES; site++) {
+		printf("%-14s %9u %8.2f %8.2f\n", sites[site], stats.count[site], stats.max[site] / 12.0,
+				stats.count[site] ? (double) stats.sum[site] / stats.count[site] / 12.0 : 0.0);
+	}
+	return 0;
+}
+
+static int showLoop(void) {
+	static const char *stages[LOOP_STAGES] = { "usbPoll", "housekeeping", "keyboard", "report" };
+	static const int bounds[LOOP_BUCKETS - 1] = { LOOP_BOUNDS(SAME) };
+	loopStats_t stats;
+	int stage, bucket, got;
+
+	if (checkFirmware())
+		return -1;
+	got = readBlock(DIAG_RQ_LOOP, &stats, sizeof(stats));
+	if (got == 0) {
+		fprintf(stderr, "sundiag: firmware built without KBD_LOOP_PROFILE\n");
+		return -1;
+	}
+	if (got != sizeof(stats))
+		return -1;
+	printf("iterations       %u\n", stats.iterations);
+	printf("worst iteration  %.3f ms of the 50 ms usbPoll() deadline\n", stats.maxIteration / 1500.0);
+	printf("stage              max us  mean us\n");
+	for (stage = 0; stage < LOOP_STAGES; stage++) {
+		printf("%-14s %9.1f %8.2f\n", stages[stage], stats.stageMax[stage] / 1.5,
+				stats.iterations ? (double) stats.stageSum[stage] / stats.iterations / 1.5 : 0.0);
+	}
+	printf("iteration time   count\n");
+	for (bucket = 0; bucket < LOOP_BUCKETS; bucket++) {
+		if (bucket < LOOP_BUCKETS - 1)
+			printf("< %6d us  %9u\n", bounds[bucket], stats.buckets[bucket]);
+		else
+			printf(">=%6d us  %9u\n", bounds[bucket - 1], stats.buckets[bucket]);
+	}
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	int result = -1;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s counters | config | trace | latency | critical | loop | clear | layout <0|1|2>\n", argv[0]);
+		return 2;
+	}
+	if (libusb_init(NULL) < 0)
+		return 1;
+	device = libusb_open_device_with_vid_pid(NULL, SUNDIAG_VID, SUNDIAG_PID);
+	if (!device) {
+		fprintf(stderr, "sundiag: adapter not found\n");
+		libusb_exit(NULL);
+		return 1;
+	}
+
+	if (!strcmp(argv[1], "counters"))
+		result = showCounters();
+	else if (!strcmp(argv[1], "config"))
+		result = showConfig();
+	else if (!strcmp(argv[1], "trace"))
+		result = showTrace();
+	else if (!strcmp(argv[1], "latency"))
+		result = showLatency();
+	else if (!strcmp(argv[1], "critical"))
+		result = showCritical();
+	else if (!strcmp(argv[1], "loop"))
+		result = showLoop();
+	else if (!strcmp(argv[1], "clear"))
+		result = request(DIAG_RQ_CLEAR, 0);
+	else if (!strcmp(argv[1], "layout") && argc > 2)
+		result = request(DIAG_RQ_SET_LAYOUT, atoi(argv[2]));
+	else
+		fprintf(stderr, "sundiag: unknown command %s\n", argv[1]);
+
+	libusb_close(device);
+	libusb_exit(NULL);
+	return result ? 1 : 0;
+}
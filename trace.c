@@ -0,0 +1,18 @@
+/*
+ * trace.c - part of USBaspSunType5c
+ *
+ * Description....: Compile time filtered event trace into a RAM ring
+ * Licence........: GNU GPL v3 (see LICENSE)
+ *
+ * Replaces bit banging values out on PC2: recording an event is a few
+ * stores, so the receiver timing is the same with tracing on or off, and
+ * the ring is read over USB instead of with a logic analyzer.
+ */
+
+#include <inttypes.h>
+#include "trace.h"
+
+#if KBD_TRACE_LEVEL
+diagTraceEntry_t traceRing[DIAG_TRACE_SIZE];
+uint8_t traceHead;
+#endif
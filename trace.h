@@ -0,0 +1,64 @@
+/*
+ * trace.h - part of USBaspSunType5c
+ *
+ * Description....: Compile time filtered event trace into a RAM ring
+ * Licence........: GNU GPL v3 (see LICENSE)
+ */
+
+#ifndef __trace_h_included__
+#define __trace_h_included__
+
+#include <stdint.h>
+#include "clock.h"
+#include "diagProtocol.h"
+
+/* levels, an event is kept if its level is at most KBD_TRACE_LEVEL */
+#define TRACE_OFF           0
+#define TRACE_ERROR         1
+#define TRACE_INFO          2
+#define TRACE_DEBUG         3
+
+/* categories, an event is kept if its bit is in KBD_TRACE_CATEGORIES */
+#define TRACE_KEYBOARD      0x01    /* bytes and handshake of the keyboard */
+#define TRACE_KEYMAP        0x02    /* translation of scancodes */
+#define TRACE_USB           0x04    /* requests of the host */
+#define TRACE_RX            0x08    /* receiver interrupt */
+#define TRACE_TX            0x10    /* transmitter interrupt */
+
+/* Off by default, a release build has no tracing code or RAM. "make
+ * DEBUG=1" sets KBD_TRACE_LEVEL to TRACE_DEBUG, which includes the events
+ * of the interrupts; -DKBD_TRACE_LEVEL=2 in CFLAGS keeps the main loop's
+ * only. Read the ring with 'sundiag trace'. */
+#ifndef KBD_TRACE_LEVEL
+#define KBD_TRACE_LEVEL     TRACE_OFF
+#endif
+#ifndef KBD_TRACE_CATEGORIES
+#define KBD_TRACE_CATEGORIES 0xff
+#endif
+
+#define TRACE_MASK          (DIAG_TRACE_SIZE - 1)
+
+#if KBD_TRACE_LEVEL
+extern diagTraceEntry_t traceRing[DIAG_TRACE_SIZE];
+extern uint8_t traceHead;
+
+/* no locking: an interrupt tracing in between the store and the increment
+ * costs one entry, never the ring */
+static inline void traceWrite(uint8_t event, uint8_t data) {
+	diagTraceEntry_t entry = { clockMillis(), event, data };
+
+	traceRing[traceHead] = entry;
+	traceHead = (traceHead + 1) & TRACE_MASK;
+}
+#else
+#define traceWrite(event, data) ((void) 0)
+#endif
+
+/* both conditions are constant, events filtered out leave no code behind */
+#define traceEvent(level, category, event, data) \
+	do { \
+		if (KBD_TRACE_LEVEL >= (level) && (KBD_TRACE_CATEGORIES & (category))) \
+			traceWrite((event), (data)); \
+	} while (0)
+
+#endif /* __trace_h_included__ */
@@ -126,7 +126,7 @@ section at the end of this file).
  * transfers. Set it to 0 if you don't need it and want to save a couple of
  * bytes.
  */
-#define USB_CFG_IMPLEMENT_FN_READ       0
+#define USB_CFG_IMPLEMENT_FN_READ       1
 /* Set this to 1 if you need to send control replies which are generated
  * "on the fly" when usbFunctionRead() is called. If you only want to send
  * data from a static buffer, set it to 0 and return the data from
@@ -160,10 +160,10 @@ section at the end of this file).
  * proceed, do a return after doing your things. One possible application
  * (besides debugging) is to flash a status LED on each packet.
  */
-/*#define USB_RESET_HOOK(resetStarts)     if(!resetStarts){hadUsbReset();}
+#define USB_RESET_HOOK(resetStarts)     if(!resetStarts){hadUsbReset();}
 #ifndef __ASSEMBLER__
 extern void hadUsbReset(void); // define the function for usbdrv.c
-#endif*/
+#endif
 /* This macro is a hook if you need to know when an USB RESET occurs. It has
  * one parameter which distinguishes between the start of RESET state and its
  * end.
@@ -281,12 +281,26 @@ extern void hadUsbReset(void); // define the function for usbdrv.c
  * HID class is 3, no subclass and protocol required (but may be useful!)
  * CDC class is 2, use subclass 2 and protocol 1 for ACM
  */
-#define USB_CFG_HID_REPORT_DESCRIPTOR_LENGTH    63
+#ifndef KBD_LAYOUT
+#define KBD_LAYOUT                              0
+#endif
+/* The report layout used until one is stored in EEPROM (hidLayoutSetting,
+ * see hidDescriptor.c): 0 is the plain boot report with 6 key rollover, 1
+ * adds a bitmap of every key held after it (N key rollover), 2 sends the
+ * volume, mute and power keys in Consumer Control and System Control
+ * reports with their own report IDs instead of as keyboard page usages,
+ * which most hosts ignore.
+ */
+#if KBD_LAYOUT > 2
+#error "KBD_LAYOUT must be 0, 1 or 2"
+#endif
+#define USB_CFG_HID_REPORT_DESCRIPTOR_LENGTH    0
 /* Define this to the length of the HID report descriptor, if you implement
  * an HID device. Otherwise don't define it or define it to 0.
  * If you use this define, you must add a PROGMEM character array named
  * "usbHidReportDescriptor" to your code which contains the report descriptor.
  * Don't forget to keep the array and this define in sync!
+ * Not used here, the descriptors are picked at runtime, see hidDescriptor.c.
  */
 
 /* #define USB_PUBLIC static */
@@ -347,14 +361,14 @@ extern void hadUsbReset(void); // define the function for usbdrv.c
  */
 
 #define USB_CFG_DESCR_PROPS_DEVICE                  0
-#define USB_CFG_DESCR_PROPS_CONFIGURATION           0
+#define USB_CFG_DESCR_PROPS_CONFIGURATION           (USB_PROP_IS_DYNAMIC | USB_PROP_IS_RAM)
 #define USB_CFG_DESCR_PROPS_STRINGS                 0
 #define USB_CFG_DESCR_PROPS_STRING_0                0
 #define USB_CFG_DESCR_PROPS_STRING_VENDOR           0
 #define USB_CFG_DESCR_PROPS_STRING_PRODUCT          0
 #define USB_CFG_DESCR_PROPS_STRING_SERIAL_NUMBER    0
-#define USB_CFG_DESCR_PROPS_HID                     0
-#define USB_CFG_DESCR_PROPS_HID_REPORT              0
+#define USB_CFG_DESCR_PROPS_HID                     (USB_PROP_IS_DYNAMIC | USB_PROP_IS_RAM)
+#define USB_CFG_DESCR_PROPS_HID_REPORT              USB_PROP_IS_DYNAMIC
 #define USB_CFG_DESCR_PROPS_UNKNOWN                 0
 
 /* ----------------------- Optional MCU Description ------------------------ */